@@ -1,8 +1,15 @@
 #include "metrics.hpp"
+#include "streams.hpp"
 #include <unordered_map>
 #include <map>
 #include <cstring>
 #include <algorithm>
+#include <numeric>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+	#include <immintrin.h>
+#endif
 
 namespace epsilon::ml::rf::algorithm::metrics
 {
@@ -16,61 +23,29 @@ namespace epsilon::ml::rf::algorithm::metrics
 
 	int majority_label(const std::vector<int>& indices)
 	{
-		std::unordered_map<int, int> freq;
-
-	#ifdef __USE_OMP__
-		#pragma omp parallel
-		{
-			#pragma omp for schedule(dynamic)
-			for (size_t i = 0; i < indices.size(); i++)
-			{
-				#pragma omp critical
-				++freq[indices[i]];
-			}
-		}
-	#else
+		std::vector<int> counts(*std::max_element(indices.begin(), indices.end()) + 1, 0);
 		for (const int& idx : indices)
 		{
-			++freq[idx];
+			++counts[idx];
 		}
-	#endif
 
-		return std::max_element(freq.begin(), freq.end(),
-			[](const auto& a, const auto& b) {
-				return a.second < b.second;
-			})->first;
+		return majority_label(counts.data(), counts.size());
+	}
+
+	int majority_label(const int* counts, size_t n_classes)
+	{
+		return static_cast<int>(std::max_element(counts, counts + n_classes) - counts);
 	}
 
 	float gini(const std::vector<int>& indices)
 	{
-		int n = indices.size();
-		std::unordered_map<int, int> freq;
-		
-	#ifdef __USE_OMP__
-		#pragma omp parallel
-		{
-			#pragma omp for schedule(dynamic)
-			for (size_t i = 0; i < indices.size(); i++)
-			{
-				#pragma omp critical
-				++freq[indices[i]];
-			}
-		}
-	#else
+		std::vector<int> counts(*std::max_element(indices.begin(), indices.end()) + 1, 0);
 		for (const int& idx : indices)
 		{
-			++freq[idx];
-		}
-	#endif
-
-		float gini = 1.0f;
-		for (const auto& [group, count] : freq)
-		{
-			float p = static_cast<float>(count) / n;
-			gini -= p*p;
+			++counts[idx];
 		}
 
-		return gini;
+		return gini(counts.data(), counts.size());
 	}
 
 	float gini(const std::unordered_map<int, int>& freq)
@@ -88,25 +63,195 @@ namespace epsilon::ml::rf::algorithm::metrics
 			? 0.0f
 			: 1 - static_cast<float>(sum_sq) / (n * n);
 	}
+
+	float gini(const int* counts, size_t n_classes)
+	{
+		double n = 0.0;
+		double sum_sq = 0.0;
+
+		for (size_t k = 0; k < n_classes; k++)
+		{
+			n += counts[k];
+			sum_sq += Gini::term(counts[k]);
+		}
+
+		return Gini::impurity(n, sum_sq);
+	}
 	
 	std::vector<int> bootstrap(int N, std::mt19937& rng)
 	{
 		std::uniform_int_distribution<int> dist(0, N-1);
 		std::vector<int> indices(N);
-		//indices.reserve(N);
 
-	#ifdef __USE_OMP__
-		#pragma omp parallel for schedule(dynamic)
-	#endif
+		// The engine is sequential state, draws cannot be spread over threads
 		for (int i = 0; i < N; i++)
 		{
 			indices[i] = dist(rng);
-			//indices.emplace_back(dist(rng));
 		}
 
 		return indices;
 	}
 
+	std::vector<int> bootstrap(int N, uint64_t seed, uint64_t tree)
+	{
+		const streams::Stream stream(seed, tree);
+		std::vector<int> indices(N);
+
+		#pragma omp simd
+		for (int i = 0; i < N; i++)
+		{
+			indices[i] = static_cast<int>(streams::bounded(stream.at(i), N));
+		}
+
+		return indices;
+	}
+
+	namespace
+	{
+		// n draws over [0, offsets[n_cells]) counted per cell
+		template <class Offset>
+		void count_draws(const Offset* offsets, size_t n_cells, uint64_t n, const streams::Stream& stream, int* counts)
+		{
+			const uint64_t N = static_cast<uint64_t>(offsets[n_cells]);
+
+			std::fill(counts, counts + n_cells, 0);
+			if (N == 0) return;
+
+			// Guide table: first cell of each of n_cells equal slices of [0, N),
+			// a draw then scans forward from its slice's cell, O(1) expected
+			std::vector<size_t> guide(n_cells);
+			for (size_t b = 0, c = 0; b < n_cells; b++)
+			{
+				const uint64_t j0 = static_cast<uint64_t>((static_cast<unsigned __int128>(b) * N) / n_cells);
+				while (static_cast<uint64_t>(offsets[c + 1]) <= j0) c++;
+				guide[b] = c;
+			}
+
+			for (uint64_t i = 0; i < n; i++)
+			{
+				const uint64_t j = streams::bounded(stream.at(i), N);
+				const size_t b = static_cast<size_t>((static_cast<unsigned __int128>(j) * n_cells) / N);
+
+				size_t c = guide[b];
+				while (static_cast<uint64_t>(offsets[c + 1]) <= j) c++;
+				++counts[c];
+			}
+		}
+	}
+
+	void bootstrap_counts(const int* offsets, size_t n_cells, uint64_t seed, uint64_t tree, int* counts)
+	{
+		count_draws(offsets, n_cells, static_cast<uint64_t>(offsets[n_cells]), streams::Stream(seed, tree), counts);
+	}
+
+	void bootstrap_counts(const uint64_t* offsets, size_t n_cells, uint64_t n, uint64_t seed, uint64_t tree, int* counts)
+	{
+		count_draws(offsets, n_cells, n, streams::Stream(seed, tree), counts);
+	}
+
+	size_t quantile_edges(const sketch::QuantileSketch& sketch, float* edges)
+	{
+		const std::vector<std::pair<float, uint64_t>> items = sketch.weighted();
+		size_t n_bins = 0;
+
+		if (items.size() <= MAX_BINS)
+		{
+			for (const auto& [value, _] : items)
+			{
+				edges[n_bins++] = value;
+			}
+		}
+		else
+		{
+			const uint64_t total = sketch.count();
+			uint64_t rank = 0;
+			size_t j = 0;
+
+			for (size_t b = 0; b < MAX_BINS; ++b)
+			{
+				const uint64_t target = b * total / MAX_BINS;
+				while (rank + items[j].second <= target)
+				{
+					rank += items[j++].second;
+				}
+
+				if (n_bins == 0 || items[j].first > edges[n_bins - 1])
+				{
+					edges[n_bins++] = items[j].first;
+				}
+			}
+		}
+
+		// Retained items may miss the extremes, the sketch tracks them exactly
+		edges[0] = sketch.min();
+		edges[n_bins] = sketch.max() + 1e-5f;
+
+		return n_bins;
+	}
+
+	void assign_bins(const float* edges, size_t n_bins,
+		const float* values, uint8_t* out, size_t n, size_t stride)
+	{
+		size_t i = 0;
+
+	#if defined(__AVX512F__) || defined(__AVX2__)
+		if (stride == 1 && n_bins > 1)
+		{
+			// Inner edges padded with +inf, every lane takes the same log2(MAX_BINS) steps
+			alignas(64) float inner[MAX_BINS];
+			std::fill(inner, inner + MAX_BINS, std::numeric_limits<float>::infinity());
+			std::copy(edges + 1, edges + n_bins, inner);
+			const int last = static_cast<int>(n_bins) - 1;
+
+		#if defined(__AVX512F__)
+			for (; i + 16 <= n; i += 16)
+			{
+				// Masked forms with explicit sources, the unmasked ones start from undefined registers
+				const __m512 v = _mm512_loadu_ps(values + i);
+				__m512i pos = _mm512_setzero_si512();
+
+				for (int step = MAX_BINS / 2; step > 0; step /= 2)
+				{
+					const __m512i probe = _mm512_add_epi32(pos, _mm512_set1_epi32(step - 1));
+					const __m512 e = _mm512_mask_i32gather_ps(v, 0xFFFF, probe, inner, sizeof(float));
+					const __mmask16 le = _mm512_cmp_ps_mask(e, v, _CMP_LE_OQ);
+					pos = _mm512_mask_add_epi32(pos, le, pos, _mm512_set1_epi32(step));
+				}
+
+				pos = _mm512_mask_min_epi32(pos, 0xFFFF, pos, _mm512_set1_epi32(last));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+					_mm512_mask_cvtepi32_epi8(_mm_setzero_si128(), 0xFFFF, pos));
+			}
+		#else
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m256 v = _mm256_loadu_ps(values + i);
+				__m256i pos = _mm256_setzero_si256();
+
+				for (int step = MAX_BINS / 2; step > 0; step /= 2)
+				{
+					const __m256i probe = _mm256_add_epi32(pos, _mm256_set1_epi32(step - 1));
+					const __m256 e = _mm256_i32gather_ps(inner, probe, sizeof(float));
+					const __m256 le = _mm256_cmp_ps(e, v, _CMP_LE_OQ);
+					pos = _mm256_add_epi32(pos,
+						_mm256_and_si256(_mm256_castps_si256(le), _mm256_set1_epi32(step)));
+				}
+
+				pos = _mm256_min_epi32(pos, _mm256_set1_epi32(last));
+				const __m128i words = _mm_packus_epi32(
+					_mm256_castsi256_si128(pos), _mm256_extracti128_si256(pos, 1));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+			}
+		#endif
+		}
+	#endif
+
+		for (; i < n; ++i)
+		{
+			out[i * stride] = bin_index(edges, n_bins, values[i * stride]);
+		}
+	}
+
 	void discretize(std::vector<uint8_t>& X_binned, std::vector<float>& bin_edges,
 		const std::vector<float>& X, std::pair<size_t, size_t> size)
 	{
@@ -119,80 +264,39 @@ namespace epsilon::ml::rf::algorithm::metrics
 	    {
 	        const float* Xf = X.data() + feat;
 	        uint8_t* Xf_binned = X_binned.data() + feat;
-	        std::vector<float> data_feature(SAMPLES_SIZE);
-	        
-			#pragma omp simd
-	        for (size_t i = 0; i < SAMPLES_SIZE; ++i)
-	        {
-	            data_feature[i] = Xf[i * FEATURES_SIZE];
-	        }
-	        
-	        std::sort(data_feature.begin(), data_feature.end());
-	        data_feature.erase(
-	        	std::unique(data_feature.begin(), data_feature.end()), 
-	        	data_feature.end());
-	        
-	        size_t n_bins = std::min(data_feature.size(), MAX_BINS);
-	        
 	        float* edges = bin_edges.data() + feat * (MAX_BINS + 1);
 
-	        #pragma omp simd
-	        for (size_t b = 0; b < n_bins; ++b)
-	        {
-	            edges[b] = data_feature[b * data_feature.size() / n_bins];
-	        }
-	        edges[n_bins] = data_feature.back() + 1e-5f;
-
-			#pragma omp simd
-	        for (size_t i = 0; i < SAMPLES_SIZE; ++i)
-	        {
-	            float val = Xf[i * FEATURES_SIZE];
-	            auto it = std::upper_bound(edges, edges + n_bins + 1, val);
-	            Xf_binned[i * FEATURES_SIZE] = static_cast<uint8_t>(std::distance(edges, it) - 1);
-	        }
+	        sketch::QuantileSketch sketch(4096, MAX_BINS);
+	        sketch.update(Xf, SAMPLES_SIZE, FEATURES_SIZE);
+
+	        const size_t n_bins = quantile_edges(sketch, edges);
+	        assign_bins(edges, n_bins, Xf, Xf_binned, SAMPLES_SIZE, FEATURES_SIZE);
 	    }
 	}
 
 	void discretize_t(std::vector<uint8_t>& X_binned, std::vector<float>& bin_edges,
-		const std::vector<float>& X, std::pair<size_t, size_t> size)
+		const std::vector<float>& X, std::pair<size_t, size_t> size,
+		std::vector<uint8_t>* exact_bins)
 	{
 		const auto& [FEATURES_SIZE, SAMPLES_SIZE] = size;
 		X_binned.resize(SAMPLES_SIZE * FEATURES_SIZE);
 		bin_edges.resize((MAX_BINS + 1) * FEATURES_SIZE);
+		if (exact_bins) exact_bins->assign(FEATURES_SIZE, 0);
 
 		#pragma omp parallel for schedule(dynamic)
 	    for (size_t feat = 0; feat < FEATURES_SIZE; ++feat)
 	    {
 	        const float* Xf = X.data() + feat * SAMPLES_SIZE;
 	        uint8_t* Xf_binned = X_binned.data() + feat * SAMPLES_SIZE;
-	        std::vector<float> data_feature(SAMPLES_SIZE, 0.0f);
-
-	        //std::memcpy(data_feature.data(), Xf, SAMPLES_SIZE * sizeof(float));
-
-	        data_feature.assign(Xf, Xf + SAMPLES_SIZE);
-	        std::sort(data_feature.begin(), data_feature.end());
-	        data_feature.erase(
-	        	std::unique(data_feature.begin(), data_feature.end()), 
-	        	data_feature.end());
-	        
-	        size_t n_bins = std::min(data_feature.size(), MAX_BINS);
-	        
 	        float* edges = bin_edges.data() + feat * (MAX_BINS + 1);
 
-	        #pragma omp simd
-	        for (size_t b = 0; b < n_bins; ++b)
-	        {
-	            edges[b] = data_feature[b * data_feature.size() / n_bins];
-	        }
-	        edges[n_bins] = data_feature.back() + 1e-5f;
-
-			#pragma omp simd
-	        for (size_t i = 0; i < SAMPLES_SIZE; ++i)
-	        {
-	            float val = Xf[i];
-	            auto it = std::upper_bound(edges, edges + n_bins + 1, val);
-	            Xf_binned[i] = static_cast<uint8_t>(std::distance(edges, it) - 1);
-	        }
+	        // One pass, no sorted copy of the feature
+	        sketch::QuantileSketch sketch(4096, MAX_BINS);
+	        sketch.update(Xf, SAMPLES_SIZE);
+
+	        const size_t n_bins = quantile_edges(sketch, edges);
+	        if (exact_bins) (*exact_bins)[feat] = sketch.exact();
+	        assign_bins(edges, n_bins, Xf, Xf_binned, SAMPLES_SIZE);
 	    }
 	}
 
@@ -212,4 +316,67 @@ namespace epsilon::ml::rf::algorithm::metrics
 
 		return Xt;
 	}
-}
\ No newline at end of file
+
+	std::vector<int> argsort_t(const std::vector<float>& X, std::pair<size_t, size_t> size)
+	{
+		const auto& [FEATURES_SIZE, SAMPLES_SIZE] = size;
+		std::vector<int> orders(FEATURES_SIZE * SAMPLES_SIZE);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (size_t feat = 0; feat < FEATURES_SIZE; ++feat)
+		{
+			const float* Xf = X.data() + feat * SAMPLES_SIZE;
+			int* order = orders.data() + feat * SAMPLES_SIZE;
+
+			std::iota(order, order + SAMPLES_SIZE, 0);
+			std::sort(order, order + SAMPLES_SIZE, [Xf] (const int a, const int b) {
+				return Xf[a] < Xf[b] || (Xf[a] == Xf[b] && a < b);
+			});
+		}
+
+		return orders;
+	}
+
+	std::vector<int> bootstrap_orders(const std::vector<int>& orders, const std::vector<int>& boot,
+		std::pair<size_t, size_t> size)
+	{
+		const auto& [FEATURES_SIZE, SAMPLES_SIZE] = size;
+		const size_t N = boot.size();
+
+		// Drawn positions grouped by source row (CSR)
+		std::vector<int> offsets(SAMPLES_SIZE + 1, 0);
+		std::vector<int> positions(N);
+
+		for (size_t i = 0; i < N; i++)
+		{
+			++offsets[boot[i] + 1];
+		}
+
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < N; i++)
+		{
+			positions[cursor[boot[i]]++] = static_cast<int>(i);
+		}
+
+		std::vector<int> result(FEATURES_SIZE * N);
+
+		for (size_t feat = 0; feat < FEATURES_SIZE; ++feat)
+		{
+			const int* order = orders.data() + feat * SAMPLES_SIZE;
+			int* out = result.data() + feat * N;
+
+			for (size_t k = 0; k < SAMPLES_SIZE; k++)
+			{
+				const int row = order[k];
+				for (int j = offsets[row]; j < offsets[row + 1]; j++)
+				{
+					*out++ = positions[j];
+				}
+			}
+		}
+
+		return result;
+	}
+}
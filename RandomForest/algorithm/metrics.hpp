@@ -1,17 +1,41 @@
 #ifndef __ML_RF_ALGORITHM_METRICS__
 #define __ML_RF_ALGORITHM_METRICS__
 
+#include <cmath>
 #include <vector>
+#include <cstdint>
 #include <random>
+#include <concepts>
+#include <algorithm>
 #include <unordered_map>
+#include <memory_resource>
+#include "sketch.hpp"
 
 namespace epsilon::ml::rf::algorithm::metrics
 {
 	const size_t MAX_BINS = 256;
 	constexpr size_t PREFETCH_DISTANCE = 16;
 
+	/**
+	 * Categorical features hold integer codes in [0, MAX_CATEGORIES),
+	 * a split sends the codes set in a 64-bit mask to the left.
+	 */
+	constexpr size_t MAX_CATEGORIES = 64;
+
+	inline bool is_category(float value)
+	{
+		return value >= 0.0f && value < MAX_CATEGORIES && value == std::floor(value);
+	}
+
+	// Unknown codes (out of range, NaN) go right
+	inline bool in_categories(uint64_t categories, float value)
+	{
+		return value >= 0.0f && value < MAX_CATEGORIES && ((categories >> static_cast<int>(value)) & 1);
+	}
+
 	int majority_label(const std::unordered_map<int, int>& freq);
 	int majority_label(const std::vector<int>& indices);
+	int majority_label(const int* counts, size_t n_classes);
 
 	/**
 	 * (Classification)
@@ -20,6 +44,93 @@ namespace epsilon::ml::rf::algorithm::metrics
 	 */
 	float gini(const std::vector<int>& indices);
 	float gini(const std::unordered_map<int, int>& freq);
+	float gini(const int* counts, size_t n_classes);
+
+	/**
+	 * Impurity criteria (compile-time policies)
+	 * 
+	 * impurity(n, S) with S = ∑ term(c_i) | i -> 1...k
+	 * Moving w samples of class i only changes one term, so children
+	 * statistics are updated in O(1) during the threshold sweep.
+	 */
+	struct Gini
+	{
+		static double term(double count) { return count * count; }
+
+		static float impurity(double n, double sum)
+		{
+			return n == 0 ? 0.0f : static_cast<float>(1.0 - sum / (n * n));
+		}
+	};
+
+	/**
+	 * entropy = log2(n) - ∑ c_i log2(c_i) / n
+	 */
+	struct Entropy
+	{
+		static double term(double count) { return count > 0 ? count * std::log2(count) : 0.0; }
+
+		static float impurity(double n, double sum)
+		{
+			return n == 0 ? 0.0f : static_cast<float>(std::log2(n) - sum / n);
+		}
+	};
+
+	template <class Criterion>
+	concept ImpurityCriterion = requires(double x) {
+		{ Criterion::term(x) } -> std::convertible_to<double>;
+		{ Criterion::impurity(x, x) } -> std::convertible_to<float>;
+	};
+
+	/**
+	 * Dense per-class counts with a running criterion statistic.
+	 */
+	template <ImpurityCriterion Criterion = Gini>
+	class ClassCounts
+	{
+	public:
+		ClassCounts(size_t n_classes, std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+			: counts(n_classes, 0, mr)
+		{}
+
+		void add(int label, int w = 1)
+		{
+			int& c = counts[label];
+			sum += Criterion::term(c + w) - Criterion::term(c);
+			c += w;
+			n += w;
+		}
+
+		void remove(int label, int w = 1)
+		{
+			add(label, -w);
+		}
+
+		void assign(const ClassCounts& other)
+		{
+			std::copy(other.counts.begin(), other.counts.end(), counts.begin());
+			n = other.n;
+			sum = other.sum;
+		}
+
+		void clear()
+		{
+			std::fill(counts.begin(), counts.end(), 0);
+			n = 0;
+			sum = 0.0;
+		}
+
+		float impurity() const { return Criterion::impurity(n, sum); }
+		int majority() const { return majority_label(counts.data(), counts.size()); }
+		bool pure() const { return n > 0 && *std::max_element(counts.begin(), counts.end()) == n; }
+		int size() const { return n; }
+		const int* data() const { return counts.data(); }
+
+	private:
+		std::pmr::vector<int> counts;
+		int n = 0;
+		double sum = 0.0;
+	};
 
 	/**
 	 * Bootstrap sampling (Bagging)
@@ -28,13 +139,91 @@ namespace epsilon::ml::rf::algorithm::metrics
 	 */
 	std::vector<int> bootstrap(int N, std::mt19937& rng);
 
+	/**
+	 * Same draw from the counter-based stream (seed, tree): index i only
+	 * depends on i, so the loop has no shared state and any split of it
+	 * across threads gives the same sample.
+	 */
+	std::vector<int> bootstrap(int N, uint64_t seed, uint64_t tree);
+
+	/**
+	 * Same draw counted per cell instead of listed: cell c stands for the
+	 * rows [offsets[c], offsets[c + 1]) and counts[c] receives how many of
+	 * the N = offsets[n_cells] draws fell there. Nothing of size N is kept.
+	 */
+	void bootstrap_counts(const int* offsets, size_t n_cells, uint64_t seed, uint64_t tree, int* counts);
+
+	/**
+	 * Same over 64-bit offsets, for cells standing for 2^31 rows or more:
+	 * n draws (below 2^31, counts stay int) instead of offsets[n_cells].
+	 */
+	void bootstrap_counts(const uint64_t* offsets, size_t n_cells, uint64_t n, uint64_t seed, uint64_t tree, int* counts);
+
+	/**
+	 * Equal-frequency edges from a sketch: edges[0 .. n_bins] with
+	 * edges[0] the minimum and edges[n_bins] just above the maximum.
+	 * Features with at most MAX_BINS distinct values get one bin per value
+	 * (sketch.exact()), whose lower edge is the value itself.
+	 */
+	size_t quantile_edges(const sketch::QuantileSketch& sketch, float* edges);
+
+	/**
+	 * Bin of a value: the number of inner edges edges[1 .. n_bins - 1] not
+	 * above it. Branchless binary search, out of range values clamp to the
+	 * first or last bin.
+	 */
+	inline uint8_t bin_index(const float* edges, size_t n_bins, float value)
+	{
+		const float* base = edges + 1;
+		size_t len = n_bins - 1;
+
+		if (len == 0) return 0;
+
+		while (len > 1)
+		{
+			const size_t half = len / 2;
+			base += (base[half - 1] <= value) * half;
+			len -= half;
+		}
+
+		return static_cast<uint8_t>((base - edges - 1) + (*base <= value));
+	}
+
+	/**
+	 * Bins of n values, out[i * stride] = bin_index(edges, n_bins, values[i * stride]).
+	 * Contiguous input is binned 16 (AVX-512) or 8 (AVX2) values at a time
+	 * with a gather-based search, the rest falls back to bin_index.
+	 * Training and serving must both go through here to agree on bins.
+	 */
+	void assign_bins(const float* edges, size_t n_bins,
+		const float* values, uint8_t* out, size_t n, size_t stride = 1);
+
 	void discretize(std::vector<uint8_t>& X_binned, std::vector<float>& bin_edges,
 		const std::vector<float>& X, std::pair<size_t, size_t> size);
 
+	/**
+	 * Feature-major discretize. exact_bins, when given, receives per feature
+	 * 1 if every bin holds a single value.
+	 */
 	void discretize_t(std::vector<uint8_t>& X_binned, std::vector<float>& bin_edges,
-		const std::vector<float>& X, std::pair<size_t, size_t> size);
+		const std::vector<float>& X, std::pair<size_t, size_t> size,
+		std::vector<uint8_t>* exact_bins = nullptr);
 
 	std::vector<float> transpose(const std::vector<float> &X, std::pair<size_t, size_t> size);
+
+	/**
+	 * Per-feature sample orders of a feature-major matrix: order[f * N + k]
+	 * is the k-th smallest sample of feature f, ties broken by index.
+	 */
+	std::vector<int> argsort_t(const std::vector<float>& X, std::pair<size_t, size_t> size);
+
+	/**
+	 * Orders of a bootstrap sample derived from the orders of the full set,
+	 * linear per feature instead of a sort per tree.
+	 * orders[f * N + k] indexes X, the result indexes the drawn positions.
+	 */
+	std::vector<int> bootstrap_orders(const std::vector<int>& orders, const std::vector<int>& boot,
+		std::pair<size_t, size_t> size);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "sketch.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace epsilon::ml::rf::algorithm::sketch
+{
+	QuantileSketch::QuantileSketch(size_t k, size_t distinct)
+		: k(std::max<size_t>(k, 8)), distinct(distinct), levels(1), parity(1, 0)
+	{
+		counts.reserve(distinct + 1);
+	}
+
+	void QuantileSketch::count_exact(float value, uint64_t weight)
+	{
+		auto it = std::lower_bound(counts.begin(), counts.end(), value,
+			[] (const std::pair<float, uint64_t>& item, const float v) { return item.first < v; });
+
+		if (it != counts.end() && it->first == value)
+			it->second += weight;
+		else
+			counts.emplace(it, value, weight);
+	}
+
+	void QuantileSketch::spill()
+	{
+		// A value seen c times lands once on every level h whose bit is set in c
+		for (const auto& [value, weight] : counts)
+		{
+			for (size_t h = 0; (weight >> h) != 0; h++)
+			{
+				if (!((weight >> h) & 1)) continue;
+
+				if (h >= levels.size())
+				{
+					levels.resize(h + 1);
+					parity.resize(h + 1, 0);
+				}
+				levels[h].emplace_back(value);
+			}
+		}
+
+		// Values were visited in order, every level is sorted already
+		counting = false;
+		counts.clear();
+		counts.shrink_to_fit();
+		levels[0].reserve(k);
+		compress();
+	}
+
+	void QuantileSketch::update(float value)
+	{
+		if (n == 0)
+		{
+			lo = hi = value;
+		}
+		else
+		{
+			lo = std::min(lo, value);
+			hi = std::max(hi, value);
+		}
+
+		++n;
+
+		if (counting)
+		{
+			count_exact(value, 1);
+			if (counts.size() > distinct) spill();
+			return;
+		}
+
+		levels[0].emplace_back(value);
+
+		if (levels[0].size() >= k)
+		{
+			compress();
+		}
+	}
+
+	void QuantileSketch::update(const float* values, size_t n, size_t stride)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			update(values[i * stride]);
+		}
+	}
+
+	void QuantileSketch::merge(const QuantileSketch& other)
+	{
+		if (other.n == 0) return;
+
+		if (n == 0)
+		{
+			lo = other.lo;
+			hi = other.hi;
+		}
+		else
+		{
+			lo = std::min(lo, other.lo);
+			hi = std::max(hi, other.hi);
+		}
+
+		n += other.n;
+
+		if (counting && other.counting)
+		{
+			for (const auto& [value, weight] : other.counts) count_exact(value, weight);
+			if (counts.size() > distinct) spill();
+			return;
+		}
+
+		if (counting) spill();
+
+		if (other.counting)
+		{
+			// Its counts, spilled on a copy, join the levels below
+			QuantileSketch spilled(other);
+			spilled.spill();
+			merge_levels(spilled);
+		}
+		else
+		{
+			merge_levels(other);
+		}
+
+		compress();
+	}
+
+	void QuantileSketch::merge_levels(const QuantileSketch& other)
+	{
+		if (levels.size() < other.levels.size())
+		{
+			levels.resize(other.levels.size());
+			parity.resize(other.levels.size(), 0);
+		}
+
+		for (size_t h = 0; h < other.levels.size(); h++)
+		{
+			std::vector<float>& level = levels[h];
+			const size_t middle = level.size();
+			level.insert(level.end(), other.levels[h].begin(), other.levels[h].end());
+
+			if (h > 0)
+			{
+				std::inplace_merge(level.begin(), level.begin() + middle, level.end());
+			}
+		}
+	}
+
+	void QuantileSketch::compress()
+	{
+		for (size_t h = 0; h < levels.size(); h++)
+		{
+			if (levels[h].size() < k) continue;
+
+			if (h + 1 == levels.size())
+			{
+				levels.emplace_back();
+				parity.emplace_back(0);
+			}
+
+			// Only the input level is unsorted, the others receive sorted runs
+			std::vector<float>& level = levels[h];
+			if (h == 0)
+			{
+				std::sort(level.begin(), level.end());
+			}
+
+			// An odd item out stays behind, the others pair up
+			const bool odd = level.size() & 1;
+			const size_t paired = level.size() - odd;
+			const float leftover = level.back();
+
+			std::vector<float>& up = levels[h + 1];
+			const size_t middle = up.size();
+			for (size_t i = parity[h]; i < paired; i += 2)
+			{
+				up.emplace_back(level[i]);
+			}
+			std::inplace_merge(up.begin(), up.begin() + middle, up.end());
+			parity[h] ^= 1;
+
+			level.clear();
+			if (odd) level.emplace_back(leftover);
+		}
+	}
+
+	std::vector<std::pair<float, uint64_t>> QuantileSketch::weighted() const
+	{
+		if (counting) return counts;
+
+		std::vector<std::pair<float, uint64_t>> items;
+
+		for (size_t h = 0; h < levels.size(); h++)
+		{
+			for (const float& v : levels[h])
+			{
+				items.emplace_back(v, uint64_t(1) << h);
+			}
+		}
+
+		std::sort(items.begin(), items.end());
+
+		// Merge equal values
+		size_t w = 0;
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			if (w > 0 && items[w - 1].first == items[i].first)
+				items[w - 1].second += items[i].second;
+			else
+				items[w++] = items[i];
+		}
+		items.resize(w);
+
+		return items;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef __ML_RF_ALGORITHM_SKETCH__
+#define __ML_RF_ALGORITHM_SKETCH__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace epsilon::ml::rf::algorithm::sketch
+{
+	/**
+	 * Streaming quantile sketch (KLL-style compactors)
+	 *
+	 * Level h holds up to k items of weight 2^h. A full level promotes every
+	 * other item of its sorted contents to the level above, so memory stays
+	 * O(k log(n / k)) whatever the stream length and the rank error of a
+	 * quantile is at most log2(n / k) / k. The promoted half alternates per
+	 * level instead of being drawn at random, which keeps the edges of a
+	 * dataset fixed.
+	 *
+	 * Until the stream shows more than `distinct` different values they
+	 * are counted exactly instead, so a low-cardinality feature keeps every
+	 * value, rare ones included. Past that, streams of fewer than k values
+	 * are still kept whole.
+	 */
+	class QuantileSketch
+	{
+	public:
+		explicit QuantileSketch(size_t k = 4096, size_t distinct = 256);
+
+		void update(float value);
+		void update(const float* values, size_t n, size_t stride = 1);
+		void merge(const QuantileSketch& other);
+
+		uint64_t count() const { return n; }
+		bool exact() const { return counting; }
+		float min() const { return lo; }
+		float max() const { return hi; }
+
+		/**
+		 * Retained values in ascending order with their weights, equal
+		 * values merged. Weights sum to count().
+		 */
+		std::vector<std::pair<float, uint64_t>> weighted() const;
+
+	private:
+		void count_exact(float value, uint64_t weight);
+		void spill();
+		void merge_levels(const QuantileSketch& other);
+		void compress();
+
+		size_t k;
+		size_t distinct;
+		bool counting = true;
+		std::vector<std::pair<float, uint64_t>> counts;  // ascending, while counting
+		uint64_t n = 0;
+		float lo = 0.0f;
+		float hi = 0.0f;
+		std::vector<std::vector<float>> levels;
+		std::vector<uint8_t> parity;
+	};
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __ML_RF_ALGORITHM_STREAMS__
+#define __ML_RF_ALGORITHM_STREAMS__
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <limits>
+
+namespace epsilon::ml::rf::algorithm::streams
+{
+	constexpr uint64_t GOLDEN = 0x9E3779B97F4A7C15ull;
+
+	/**
+	 * SplitMix64 finalizer
+	 */
+	constexpr uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	constexpr uint64_t derive(uint64_t seed, uint64_t key)
+	{
+		return mix(seed ^ mix(key + GOLDEN));
+	}
+
+	/**
+	 * Uniform integer in [0, n) from 64 random bits (multiply-shift)
+	 */
+	constexpr uint64_t bounded(uint64_t bits, uint64_t n)
+	{
+		return static_cast<uint64_t>((static_cast<unsigned __int128>(bits) * n) >> 64);
+	}
+
+	/**
+	 * Counter-based generator.
+	 *
+	 * Draw i of a stream is mix(key + (i + 1) * GOLDEN), so any thread can
+	 * produce any part of any stream without shared state. Streams are
+	 * keyed by (seed, tree, node), which makes a model depend on the seed
+	 * only and not on how the work was scheduled.
+	 */
+	class Stream
+	{
+	public:
+		using result_type = uint64_t;
+
+		constexpr explicit Stream(uint64_t seed, uint64_t a = 0, uint64_t b = 0)
+			: key(derive(derive(seed, a), b))
+		{}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+		constexpr result_type at(uint64_t i) const { return mix(key + (i + 1) * GOLDEN); }
+		constexpr result_type operator()() { return at(counter++); }
+
+	private:
+		uint64_t key;
+		uint64_t counter = 0;
+	};
+
+	/**
+	 * values[0, m) becomes a uniform draw without replacement of values[0, n)
+	 * (partial Fisher-Yates)
+	 */
+	template <class T>
+	void partial_shuffle(T* values, size_t n, size_t m, Stream& rng)
+	{
+		for (size_t k = 0; k < m && k + 1 < n; k++)
+		{
+			const size_t j = k + bounded(rng(), n - k);
+			std::swap(values[k], values[j]);
+		}
+	}
+}
+
+#endif
@@ -138,8 +138,15 @@ namespace epsilon::ml::rf::experimental
 		iframe.phase = 0;
 		iframe.samples.resize(SAMPLES_SIZE);
 		std::iota(iframe.samples.begin(), iframe.samples.end(), 0);
+
+		// Sorted once per tree, children inherit their orders by stable filtering
+		const std::vector<int> orders = metrics::argsort_t(
+			metrics::transpose(X, size), std::make_pair(FEATURES_SIZE, SAMPLES_SIZE));
+		iframe.sorted.assign(orders.begin(), orders.end());
 		stack.push(iframe);
 
+		std::vector<uint8_t> goes_left(SAMPLES_SIZE);
+
 		while (!stack.empty())
 		{
 			StackFrame& frame = stack.top();
@@ -210,16 +217,16 @@ namespace epsilon::ml::rf::experimental
 		            {
 		            	const int feature = selected_features[f];
 		            	const float* Xf = X.data() + feature;
+		            	const int* order = frame.sorted.data() + feature * n_samples;
 
-		            	// Sort samples per frame
+		            	// Samples are already in order for this frame
 		            	sorted_samples.clear();
 		            	std::transform(
-			            	frame.samples.begin(),
-			            	frame.samples.end(),
+			            	order,
+			            	order + n_samples,
 			            	std::back_inserter(sorted_samples),
 			            	[&] (const int& idx) { return std::make_pair(Xf[idx * FEATURES_SIZE], idx); }
 			            );
-		            	std::sort(sorted_samples.begin(), sorted_samples.end());
 
 		            	// Reuse vector
 		            	left.clear(); right.clear();
@@ -339,6 +346,27 @@ namespace epsilon::ml::rf::experimental
 	            frame.phase = 1;
 	            
 	            StackFrame l_frame;
+
+	            for (const int& idx : frame.split_left) goes_left[idx] = 1;
+	            for (const int& idx : frame.split_right) goes_left[idx] = 0;
+
+	            {
+	            	std::vector<int> r_sorted;
+	            	l_frame.sorted.reserve(n_features * frame.split_left.size());
+	            	r_sorted.reserve(n_features * frame.split_right.size());
+
+	            	for (const int& idx : frame.sorted)
+	            	{
+	            		if (goes_left[idx])
+	            			l_frame.sorted.emplace_back(idx);
+	            		else
+	            			r_sorted.emplace_back(idx);
+	            	}
+
+	            	// Parent orders are no longer needed, keep the right child's
+	            	frame.sorted = std::move(r_sorted);
+	            }
+
 	            l_frame.samples  = std::move(frame.split_left);
 	            l_frame.depth    = frame.depth + 1;
 	            l_frame.cursor   = frame.l_root;
@@ -360,6 +388,7 @@ namespace epsilon::ml::rf::experimental
 	            
 	            StackFrame r_frame;
 	            r_frame.samples  = std::move(frame.split_right);
+	            r_frame.sorted   = std::move(frame.sorted);
 	            r_frame.depth    = frame.depth + 1;
 	            r_frame.cursor   = frame.r_root;
 	            r_frame.phase    = 0;
@@ -0,0 +1,176 @@
+#include "BinnedDataset.hpp"
+#include "TaskScheduler.hpp"
+#include "../algorithm/streams.hpp"
+#include <numeric>
+#include <limits>
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	template <class Index>
+	BinnedDataset BinnedDataset::compact_rows() const
+	{
+		const size_t SAMPLES_SIZE = samples_size;
+		const size_t FEATURES_SIZE = features_size;
+
+		// FNV-1a over the row's bins, read column by column
+		std::vector<uint64_t> hashes(SAMPLES_SIZE, 0xCBF29CE484222325ull);
+		TaskScheduler::instance().parallel_for(0, SAMPLES_SIZE, 1 << 14, [&] (const size_t begin, const size_t end) {
+			for (size_t f = 0; f < FEATURES_SIZE; f++)
+			{
+				const uint8_t* Xf_binned = X_binned.data() + f * SAMPLES_SIZE;
+				for (size_t i = begin; i < end; i++)
+				{
+					hashes[i] = (hashes[i] ^ Xf_binned[i]) * 0x100000001B3ull;
+				}
+			}
+
+			for (size_t i = begin; i < end; i++)
+			{
+				hashes[i] = streams::mix(hashes[i]);
+			}
+		});
+
+		const auto same_row = [&] (const Index a, const Index b) {
+			for (size_t f = 0; f < FEATURES_SIZE; f++)
+			{
+				if (X_binned[f * SAMPLES_SIZE + a] != X_binned[f * SAMPLES_SIZE + b]) return false;
+			}
+			return true;
+		};
+
+		std::vector<Index> order(SAMPLES_SIZE);
+		std::iota(order.begin(), order.end(), Index(0));
+		std::stable_sort(order.begin(), order.end(), [&] (const Index a, const Index b) {
+			return hashes[a] < hashes[b];
+		});
+
+		// First occurrence of each row, a colliding hash compares the bins
+		std::vector<Index> first_of(SAMPLES_SIZE);
+		std::vector<Index> firsts;
+		for (size_t begin = 0, end = 0; begin < SAMPLES_SIZE; begin = end)
+		{
+			while (end < SAMPLES_SIZE && hashes[order[end]] == hashes[order[begin]]) end++;
+
+			const size_t group_firsts = firsts.size();
+			for (size_t k = begin; k < end; k++)
+			{
+				const Index idx = order[k];
+				auto it = std::find_if(firsts.begin() + group_firsts, firsts.end(),
+					[&] (const Index first) { return same_row(first, idx); });
+
+				if (it == firsts.end())
+				{
+					firsts.emplace_back(idx);
+					first_of[idx] = idx;
+				}
+				else
+				{
+					first_of[idx] = *it;
+				}
+			}
+		}
+
+		std::sort(firsts.begin(), firsts.end());
+
+		std::vector<Index> unique_of(SAMPLES_SIZE, 0);
+		for (size_t u = 0; u < firsts.size(); u++)
+		{
+			unique_of[firsts[u]] = static_cast<Index>(u);
+		}
+
+		const size_t UNIQUE_SIZE = firsts.size();
+
+		BinnedDataset data;
+		data.bin_edges = bin_edges;
+		data.exact_bins = exact_bins;
+		data.features_size = FEATURES_SIZE;
+		data.samples_size = UNIQUE_SIZE;
+		data.n_classes = n_classes;
+		data.X_binned.resize(FEATURES_SIZE * UNIQUE_SIZE);
+		data.class_counts.assign(UNIQUE_SIZE * n_classes, 0);
+		data.y.resize(UNIQUE_SIZE);
+
+		for (size_t f = 0; f < FEATURES_SIZE; f++)
+		{
+			const uint8_t* Xf_binned = X_binned.data() + f * SAMPLES_SIZE;
+			uint8_t* Xf_unique = data.X_binned.data() + f * UNIQUE_SIZE;
+
+			for (size_t u = 0; u < UNIQUE_SIZE; u++)
+			{
+				Xf_unique[u] = Xf_binned[firsts[u]];
+			}
+		}
+
+		// Counts of an already compacted set add up
+		for (size_t i = 0; i < SAMPLES_SIZE; i++)
+		{
+			int* row = data.class_counts.data() + unique_of[first_of[i]] * n_classes;
+			if (weighted())
+			{
+				const int* counts = class_counts.data() + i * n_classes;
+				for (size_t k = 0; k < n_classes; k++) row[k] += counts[k];
+			}
+			else
+			{
+				++row[y[i]];
+			}
+		}
+
+		for (size_t u = 0; u < UNIQUE_SIZE; u++)
+		{
+			data.y[u] = metrics::majority_label(data.class_counts.data() + u * n_classes, n_classes);
+		}
+
+		return data;
+	}
+
+	BinnedDataset BinnedDataset::compact() const
+	{
+		// 32-bit row indices while they fit, half the memory of 64-bit ones
+		return samples_size <= std::numeric_limits<uint32_t>::max()
+			? compact_rows<uint32_t>()
+			: compact_rows<uint64_t>();
+	}
+
+	BinnedDataset BinnedDataset::gather(const std::vector<uint64_t>& ids) const
+	{
+		const size_t n = ids.size();
+
+		BinnedDataset data;
+		data.bin_edges = bin_edges;
+		data.exact_bins = exact_bins;
+		data.features_size = features_size;
+		data.samples_size = n;
+		data.n_classes = n_classes;
+		data.X_binned.resize(features_size * n);
+		data.y.resize(n);
+
+		for (size_t f = 0; f < features_size; f++)
+		{
+			const uint8_t* Xf_binned = X_binned.data() + f * samples_size;
+			uint8_t* Xf_gathered = data.X_binned.data() + f * n;
+
+			for (size_t i = 0; i < n; i++)
+			{
+				Xf_gathered[i] = Xf_binned[ids[i]];
+			}
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			data.y[i] = y[ids[i]];
+		}
+
+		if (weighted())
+		{
+			data.class_counts.resize(n * n_classes);
+			for (size_t i = 0; i < n; i++)
+			{
+				std::copy_n(class_counts.data() + ids[i] * n_classes, n_classes, data.class_counts.data() + i * n_classes);
+			}
+		}
+
+		return data;
+	}
+}
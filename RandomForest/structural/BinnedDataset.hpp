@@ -0,0 +1,83 @@
+#ifndef __ML_RF_STRUCTURAL_BINNED_DATASET__
+#define __ML_RF_STRUCTURAL_BINNED_DATASET__
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "SplitSearch.hpp"
+#include "../algorithm/metrics.hpp"
+
+namespace metrics = epsilon::ml::rf::algorithm::metrics;
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Training set reduced to what histogram trees read: one byte per value,
+	 * feature-major, plus the bin edges and the labels. Binned once and
+	 * shared by every tree of a forest.
+	 */
+	struct BinnedDataset
+	{
+		std::vector<uint8_t> X_binned;
+		std::vector<float> bin_edges;
+		std::vector<uint8_t> exact_bins;  // per feature, see SplitContext
+		std::vector<int> y;
+		size_t features_size = 0;
+		size_t samples_size = 0;
+		size_t n_classes = 0;
+
+		// Set by compact(): rows are distinct and weighted, class_counts
+		// holds samples_size x n_classes counts and y the majority label
+		std::vector<int> class_counts;
+
+		bool weighted() const { return !class_counts.empty(); }
+
+		static BinnedDataset from(
+			const std::vector<float>& X,
+			const std::vector<int>& y,
+			const std::pair<size_t, size_t>& size)
+		{
+			BinnedDataset data;
+			metrics::discretize_t(data.X_binned, data.bin_edges, X, size, &data.exact_bins);
+			data.y = y;
+			data.features_size = size.first;
+			data.samples_size = size.second;
+			data.n_classes = static_cast<size_t>(*std::max_element(y.begin(), y.end()) + 1);
+			return data;
+		}
+
+		/**
+		 * Duplicate rows (equal bins on every feature) collapsed into one
+		 * weighted row with per-class counts, in order of first occurrence.
+		 * Split search then costs the distinct rows only. Without duplicates
+		 * a forest trained on the result equals one trained on this set.
+		 */
+		BinnedDataset compact() const;
+
+		/**
+		 * Rows ids (64-bit, any of samples_size) copied into a set of their
+		 * own, in order: trees address it with int indices.
+		 */
+		BinnedDataset gather(const std::vector<uint64_t>& ids) const;
+
+		SplitContext context() const
+		{
+			return {
+				.X_binned = X_binned.data(),
+				.bin_edges = bin_edges.data(),
+				.y = y.data(),
+				.samples_size = samples_size,
+				.features_size = features_size,
+				.n_classes = n_classes,
+				.class_counts = weighted() ? class_counts.data() : nullptr,
+				.exact_bins = exact_bins.empty() ? nullptr : exact_bins.data()
+			};
+		}
+
+	private:
+		template <class Index>
+		BinnedDataset compact_rows() const;
+	};
+}
+
+#endif
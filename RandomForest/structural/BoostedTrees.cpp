@@ -0,0 +1,356 @@
+#include "BoostedTrees.hpp"
+#include "ScratchArena.hpp"
+#include "TaskScheduler.hpp"
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace epsilon::ml::rf::structural
+{
+	namespace
+	{
+		struct GradBin
+		{
+			double g = 0.0;
+			double h = 0.0;
+			int64_t n = 0;
+		};
+
+		struct Leaf
+		{
+			size_t begin;
+			size_t end;
+			float value;
+		};
+
+		// Rows fewer than this build their histogram on one thread
+		constexpr size_t PARALLEL_ROWS = 4096;
+
+		/**
+		 * One regression tree on (grad, hess), rows holds the row indices,
+		 * partitioned in place so a node's rows are rows[begin, end).
+		 */
+		class RegressionGrower
+		{
+		public:
+			RegressionGrower(
+			    const SplitContext& ctx,
+			    const BoostedTrees::Params& params,
+			    const float* grad,
+			    const float* hess,
+			    const int* weight,
+			    std::vector<int>& rows,
+			    DecisionTree& tree)
+			    : ctx(ctx), params(params), grad(grad), hess(hess), weight(weight), rows(rows), tree(tree)
+			{}
+
+			void grow(const int max_depth)
+			{
+			    ScratchArena& arena = ScratchArena::local();
+			    ArenaScope scope(arena);
+
+			    scratch_vector<GradBin> hist(ctx.features_size * metrics::MAX_BINS, &arena);
+			    histogram(0, rows.size(), hist.data());
+			    grow_node(0, 0, rows.size(), max_depth, hist.data(), arena);
+			}
+
+			std::vector<Leaf> leaves;
+
+		private:
+			void histogram(const size_t begin, const size_t end, GradBin* hist) const
+			{
+			    const auto fill = [&] (const size_t first, const size_t last) {
+			        for (size_t f = first; f < last; f++)
+			        {
+			            const uint8_t* Xf = ctx.feature(static_cast<int>(f));
+			            GradBin* bins = hist + f * metrics::MAX_BINS;
+			            std::fill(bins, bins + metrics::MAX_BINS, GradBin{});
+
+			            for (size_t r = begin; r < end; r++)
+			            {
+			                const int idx = rows[r];
+			                GradBin& bin = bins[Xf[idx]];
+			                bin.g += grad[idx];
+			                bin.h += hess[idx];
+			                bin.n += weight ? weight[idx] : 1;
+			            }
+			        }
+			    };
+
+			    if (end - begin < PARALLEL_ROWS)
+			    {
+			        fill(0, ctx.features_size);
+			    }
+			    else
+			    {
+			        TaskScheduler::instance().parallel_for(0, ctx.features_size, 1, fill);
+			    }
+			}
+
+			void grow_node(
+			    const int node,
+			    const size_t begin,
+			    const size_t end,
+			    const int depth,
+			    GradBin* hist,
+			    ScratchArena& arena)
+			{
+			    const double lambda = params.lambda;
+
+			    // Every feature's bins sum to the node's totals
+			    GradBin total;
+			    for (size_t b = 0; b < metrics::MAX_BINS; b++)
+			    {
+			        total.g += hist[b].g;
+			        total.h += hist[b].h;
+			        total.n += hist[b].n;
+			    }
+
+			    const double parent = total.g * total.g / (total.h + lambda);
+			    const int64_t min_leaf = static_cast<int64_t>(params.min_samples_leaf);
+
+			    double best_gain = 0.0;
+			    int best_feature = -1;
+			    int best_bin = 0;
+
+			    if (depth > 0 && total.n >= 2 * min_leaf)
+			    {
+			        for (size_t f = 0; f < ctx.features_size; f++)
+			        {
+			            const GradBin* bins = hist + f * metrics::MAX_BINS;
+			            GradBin left;
+
+			            for (size_t b = 0; b + 1 < metrics::MAX_BINS; b++)
+			            {
+			                left.g += bins[b].g;
+			                left.h += bins[b].h;
+			                left.n += bins[b].n;
+
+			                const int64_t right_n = total.n - left.n;
+			                if (right_n < min_leaf) break;
+			                if (left.n < min_leaf || bins[b + 1].n == 0) continue;
+
+			                const double right_g = total.g - left.g;
+			                const double right_h = total.h - left.h;
+			                if (left.h < params.min_child_weight || right_h < params.min_child_weight) continue;
+
+			                const double gain = left.g * left.g / (left.h + lambda)
+			                    + right_g * right_g / (right_h + lambda) - parent;
+
+			                if (gain > best_gain)
+			                {
+			                    best_gain = gain;
+			                    best_feature = static_cast<int>(f);
+			                    best_bin = static_cast<int>(b + 1);
+			                }
+			            }
+			        }
+			    }
+
+			    if (best_feature < 0)
+			    {
+			        const float value = static_cast<float>(-total.g / (total.h + lambda) * params.learning_rate);
+			        tree.set_value(node, value);
+			        leaves.push_back({ begin, end, value });
+			        return;
+			    }
+
+			    const uint8_t* Xs = ctx.feature(best_feature);
+			    const size_t mid = static_cast<size_t>(std::partition(rows.begin() + begin, rows.begin() + end,
+			        [&] (const int idx) { return Xs[idx] < best_bin; }) - rows.begin());
+
+			    const int left = next++;
+			    const int right = next++;
+			    tree.set_split(node, best_feature, ctx.edges(best_feature)[best_bin], left, right);
+
+			    // Histogram the smaller child, the larger one is the parent minus it
+			    ArenaScope scope(arena);
+			    scratch_vector<GradBin> small(ctx.features_size * metrics::MAX_BINS, &arena);
+
+			    const bool left_small = mid - begin <= end - mid;
+			    if (left_small) histogram(begin, mid, small.data());
+			    else histogram(mid, end, small.data());
+
+			    for (size_t i = 0; i < small.size(); i++)
+			    {
+			        hist[i].g -= small[i].g;
+			        hist[i].h -= small[i].h;
+			        hist[i].n -= small[i].n;
+			    }
+
+			    GradBin* left_hist = left_small ? small.data() : hist;
+			    GradBin* right_hist = left_small ? hist : small.data();
+
+			    grow_node(left, begin, mid, depth - 1, left_hist, arena);
+			    grow_node(right, mid, end, depth - 1, right_hist, arena);
+			}
+
+			const SplitContext& ctx;
+			const BoostedTrees::Params& params;
+			const float* grad;
+			const float* hess;
+			const int* weight;
+			std::vector<int>& rows;
+			DecisionTree& tree;
+			int next = 1;
+		};
+	}
+
+	BoostedTrees::BoostedTrees(const Params& p)
+		: params(p)
+	{}
+
+	int BoostedTrees::predict(const std::vector<float>& data)
+	{
+		return predict(const_cast<float*>(data.data()), data.size());
+	}
+
+	int BoostedTrees::predict(float* data, size_t)
+	{
+		std::vector<float> scores(n_classes);
+		predict_scores(data, scores.data());
+		return static_cast<int>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+	}
+
+	void BoostedTrees::predict_scores(const float* x, float* scores) const
+	{
+		std::copy(base_scores.begin(), base_scores.end(), scores);
+
+		for (size_t t = 0; t < trees.size(); t++)
+		{
+			scores[t % n_classes] += trees[t]->predict_value(x);
+		}
+	}
+
+	size_t BoostedTrees::size() const
+	{
+		size_t nodes = 0;
+		for (const auto& tree : trees)
+		{
+			nodes += static_cast<size_t>(tree->size());
+		}
+
+		return nodes;
+	}
+
+	int BoostedTrees::build(
+	    const std::vector<float>& X,
+	    const std::vector<int>& y,
+	    const std::pair<size_t, size_t>& size,
+	    const std::pair<int, int>& depth,
+	    std::mt19937&)
+	{
+	    return build(BinnedDataset::from(X, y, size), depth);
+	}
+
+	int BoostedTrees::build(const BinnedDataset& data, const std::pair<int, int>& depth)
+	{
+	    const SplitContext ctx = data.context();
+	    const size_t K = data.n_classes;
+	    const size_t N = data.samples_size;
+	    const int max_depth = std::clamp(depth.second - depth.first, 0, 24);
+
+	    // Every round reads every row, through int indices
+	    if (N > static_cast<size_t>(std::numeric_limits<int>::max()))
+	    {
+	        throw std::length_error("BoostedTrees: more than 2^31 - 1 rows, compact or subsample");
+	    }
+
+	    n_classes = K;
+	    trees.clear();
+	    trees.reserve(params.rounds * K);
+
+	    // Row weights and per-class targets, counts for compacted rows
+	    std::vector<int> weight(data.weighted() ? N : 0);
+	    std::vector<double> prior(K, 0.0);
+	    for (size_t i = 0; i < N; i++)
+	    {
+	        if (data.weighted())
+	        {
+	            const int* counts = data.class_counts.data() + i * K;
+	            weight[i] = std::accumulate(counts, counts + K, 0);
+	            for (size_t k = 0; k < K; k++) prior[k] += counts[k];
+	        }
+	        else
+	        {
+	            prior[data.y[i]] += 1.0;
+	        }
+	    }
+
+	    const double total = std::accumulate(prior.begin(), prior.end(), 0.0);
+	    base_scores.resize(K);
+	    for (size_t k = 0; k < K; k++)
+	    {
+	        base_scores[k] = static_cast<float>(std::log((prior[k] + 1.0) / (total + K)));
+	    }
+
+	    std::vector<float> scores(N * K);
+	    for (size_t i = 0; i < N; i++)
+	    {
+	        std::copy(base_scores.begin(), base_scores.end(), scores.begin() + i * K);
+	    }
+
+	    std::vector<float> grad(K * N), hess(K * N);
+	    std::vector<std::vector<int>> rows(K, std::vector<int>(N));
+
+	    const size_t max_nodes = std::min<size_t>((size_t(1) << (max_depth + 1)) - 1, 2 * std::max<size_t>(N, 1) - 1);
+
+	    for (size_t round = 0; round < params.rounds; round++)
+	    {
+	        // Softmax log loss: g = w * p - c, h = w * p * (1 - p), per class
+	        TaskScheduler::instance().parallel_for(0, N, 4096, [&] (const size_t begin, const size_t end) {
+	            std::vector<double> p(K);
+	            for (size_t i = begin; i < end; i++)
+	            {
+	                const float* s = scores.data() + i * K;
+	                const float top = *std::max_element(s, s + K);
+
+	                double sum = 0.0;
+	                for (size_t k = 0; k < K; k++) sum += p[k] = std::exp(static_cast<double>(s[k] - top));
+
+	                const double w = data.weighted() ? weight[i] : 1.0;
+	                for (size_t k = 0; k < K; k++)
+	                {
+	                    const double pk = p[k] / sum;
+	                    const double c = data.weighted() ? data.class_counts[i * K + k] : (data.y[i] == static_cast<int>(k));
+	                    grad[k * N + i] = static_cast<float>(w * pk - c);
+	                    hess[k * N + i] = static_cast<float>(std::max(w * pk * (1.0 - pk), 1e-16));
+	                }
+	            }
+	        });
+
+	        std::vector<std::shared_ptr<DecisionTree>> round_trees(K);
+
+	        TaskScheduler::TaskGroup group;
+	        for (size_t k = 0; k < K; k++)
+	        {
+	            group.run([&, k] {
+	                auto tree = std::make_shared<DecisionTree>(static_cast<int>(max_nodes));
+	                std::iota(rows[k].begin(), rows[k].end(), 0);
+
+	                RegressionGrower grower(ctx, params, grad.data() + k * N, hess.data() + k * N,
+	                    data.weighted() ? weight.data() : nullptr, rows[k], *tree);
+	                grower.grow(max_depth);
+
+	                for (const Leaf& leaf : grower.leaves)
+	                {
+	                    for (size_t r = leaf.begin; r < leaf.end; r++)
+	                    {
+	                        scores[rows[k][r] * K + k] += leaf.value;
+	                    }
+	                }
+
+	                tree->compact();
+	                round_trees[k] = std::move(tree);
+	            });
+	        }
+	        group.wait();
+
+	        trees.insert(trees.end(), round_trees.begin(), round_trees.end());
+	    }
+
+	    return static_cast<int>(size());
+	}
+}
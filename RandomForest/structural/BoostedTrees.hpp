@@ -0,0 +1,80 @@
+#ifndef __ML_RF_STRUCTURAL_BOOSTED_TREES__
+#define __ML_RF_STRUCTURAL_BOOSTED_TREES__
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include "../cereal/types/vector.hpp"
+#include "../cereal/types/memory.hpp"
+#include "IDecisionNode.hpp"
+#include "DecisionTree.hpp"
+#include "BinnedDataset.hpp"
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Gradient-boosted trees, softmax over n_classes. Every round fits one
+	 * regression tree per class to the gradient of the log loss, on the
+	 * binned matrix: (gradient, hessian) histograms per node, the larger
+	 * child derived from its parent minus the smaller one.
+	 *
+	 * Trees are DecisionTree node storage with leaf values, a sample's
+	 * class scores are the base scores plus the values of its leaves.
+	 */
+	class BoostedTrees final : public IDecisionNode
+	{
+	public:
+		struct Params
+		{
+			size_t rounds = 100;
+			float learning_rate = 0.1f;
+			float lambda = 1.0f;             // L2 penalty on leaf values
+			float min_child_weight = 1e-3f;  // hessian sum of a child
+			size_t min_samples_leaf = 1;
+		};
+
+		BoostedTrees() = default;
+		BoostedTrees(const Params& p);
+
+		int predict(const std::vector<float>& data) override;
+		int predict(float* data, size_t size) override;
+
+		/**
+		 * Raw class scores (log-odds up to a constant) of one sample,
+		 * n_classes values.
+		 */
+		void predict_scores(const float* x, float* scores) const;
+
+		int build(
+		    const std::vector<float>& X,
+		    const std::vector<int>& y,
+		    const std::pair<size_t, size_t>& size,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng = internal_rng()) override;
+
+		/**
+		 * Trees of depth.second - depth.first levels at most. Weighted rows
+		 * (BinnedDataset::compact) count with their class counts.
+		 * Training is deterministic, there is no sampling.
+		 */
+		int build(const BinnedDataset& data, const std::pair<int, int>& depth);
+
+		size_t rounds() const { return n_classes ? trees.size() / n_classes : 0; }
+		size_t size() const;
+
+		template <class Archive>
+		void serialize(Archive & ar, const std::uint32_t)
+		{
+			ar(n_classes, base_scores, trees);
+		}
+
+	private:
+		Params params;
+		size_t n_classes = 0;
+		std::vector<float> base_scores;
+		std::vector<std::shared_ptr<DecisionTree>> trees;  // round-major, n_classes per round
+	};
+}
+
+#endif
@@ -2,7 +2,11 @@
 #include <stack>
 #include <chrono>
 #include <cstring>
-#include <unordered_map>
+#include <deque>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <memory_resource>
 #include <execution>
 #include "DecisionTree.hpp"
 
@@ -45,7 +49,7 @@ namespace epsilon::ml::rf::structural
         while (lefts[node] != -1 || rights[node] != -1)
         {
             float value = Xd[features[node]];
-            node = value < thresholds[node] 
+            node = goes_left(node, value) 
             	? lefts[node] 
             	: rights[node];
         }
@@ -59,7 +63,7 @@ namespace epsilon::ml::rf::structural
         while (lefts[node] != -1 || rights[node] != -1)
         {
             float value = data[features[node]];
-            node = value < thresholds[node] 
+            node = goes_left(node, value) 
             	? lefts[node] 
             	: rights[node];
         }
@@ -67,6 +71,79 @@ namespace epsilon::ml::rf::structural
         return labels[node];
 	}
 
+	int DecisionTree::predict_column(const float* X, size_t stride, size_t i) const
+	{
+		int node = 0;
+        while (lefts[node] != -1 || rights[node] != -1)
+        {
+            float value = X[features[node] * stride + i];
+            node = goes_left(node, value) 
+            	? lefts[node] 
+            	: rights[node];
+        }
+
+        return labels[node];
+	}
+
+	int DecisionTree::predict_binned(const SplitContext& ctx, size_t i) const
+	{
+		int node = 0;
+        while (lefts[node] != -1 || rights[node] != -1)
+        {
+            const int f = features[node];
+            float value = ctx.edges(f)[ctx.feature(f)[i]];
+            node = goes_left(node, value) 
+            	? lefts[node] 
+            	: rights[node];
+        }
+
+        return labels[node];
+	}
+
+	float DecisionTree::predict_value(const float* x) const
+	{
+		int node = 0;
+        while (lefts[node] != -1 || rights[node] != -1)
+        {
+            node = goes_left(node, x[features[node]]) 
+            	? lefts[node] 
+            	: rights[node];
+        }
+
+        return values[node];
+	}
+
+	DecisionTree::NodeView DecisionTree::node(int i) const
+	{
+		return {
+			features[i],
+			thresholds[i],
+			categories.empty() ? 0 : categories[i],
+			lefts[i],
+			rights[i],
+			labels[i]
+		};
+	}
+
+	void DecisionTree::set_split(int node, int feature, float threshold, int left, int right)
+	{
+		features[node] = feature;
+		thresholds[node] = threshold;
+		lefts[node] = left;
+		rights[node] = right;
+	}
+
+	void DecisionTree::set_value(int node, float value)
+	{
+		if (values.empty()) values.assign(count, 0.0f);
+		values[node] = value;
+	}
+
+	void DecisionTree::set_options(const TreeOptions& o)
+	{
+		options = o;
+	}
+
 	int DecisionTree::build(
 	    const std::vector<float>& X,
 	    const std::vector<int>& y,
@@ -74,223 +151,744 @@ namespace epsilon::ml::rf::structural
 	    const std::pair<int, int>& depth,
 	    std::mt19937& rng)
 	{
-	    std::stack<StackFrame> stack;
-	    StackFrame iframe;
-	    int max_depth = depth.second;
-	    size_t index = cursor;
 	    const size_t SAMPLES_SIZE = size.second;
 	    const size_t FEATURES_SIZE = size.first;
-	    size_t n_classes = *std::max_element(y.begin(), y.end()) + 1;
+	    const bool exact = options.split == TreeOptions::SplitMode::Exact;
+
+	    std::vector<float> bin_edges;
+	    std::vector<uint8_t> X_binned;
+	    std::vector<uint8_t> exact_bins;
 
-	    std::vector<float> bin_edges((metrics::MAX_BINS + 1) * FEATURES_SIZE);
-	    std::vector<uint8_t> X_binned(SAMPLES_SIZE * FEATURES_SIZE);
+	    if (exact)
+	    {
+	        // Sorted once per tree unless the forest already handed them over
+	        if (presorted.empty())
+	        {
+	            presorted = metrics::argsort_t(X, size);
+	        }
+	    }
+	    else
+	    {
+	        metrics::discretize_t(X_binned, bin_edges, X, size, &exact_bins);
+	    }
 
-	    metrics::discretize_t(X_binned, bin_edges, X, size);
+	    const SplitContext ctx = {
+	        .X_binned = X_binned.data(),
+	        .bin_edges = bin_edges.data(),
+	        .y = y.data(),
+	        .samples_size = SAMPLES_SIZE,
+	        .features_size = FEATURES_SIZE,
+	        .n_classes = static_cast<size_t>(*std::max_element(y.begin(), y.end()) + 1),
+	        .X = X.data(),
+	        .presorted = exact ? presorted.data() : nullptr,
+	        .exact_bins = exact ? nullptr : exact_bins.data()
+	    };
 
-	    iframe.X = X;
-	    iframe.depth = depth.first;
-	    iframe.cursor = cursor;
-	    iframe.phase = 0;
-	    iframe.samples.resize(SAMPLES_SIZE);
-	    std::iota(iframe.samples.begin(), iframe.samples.end(), 0);
-	    stack.push(iframe);
+	    grow_tree(ctx, depth, rng);
 
-	    while (!stack.empty())
+	    presorted.clear();
+	    presorted.shrink_to_fit();
+
+	    return count - 1;
+	}
+
+	int DecisionTree::build(
+	    const SplitContext& ctx,
+	    const std::vector<int>& rows,
+	    const std::pair<int, int>& depth,
+	    std::mt19937& rng)
+	{
+	    this->rows = rows;
+	    grow_tree(ctx, depth, rng);
+	    this->rows = {};
+
+	    return count - 1;
+	}
+
+	void DecisionTree::grow_tree(
+	    const SplitContext& ctx,
+	    const std::pair<int, int>& depth,
+	    std::mt19937& rng)
+	{
+	    // Every random choice below derives from this seed and the node's path
+	    const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+
+	    SplitContext limited = ctx;
+	    limited.min_samples_leaf = std::max<size_t>(1, options.min_samples_leaf);
+
+	    const std::vector<uint8_t> categorical = categorical_mask(ctx);
+	    if (!categorical.empty())
+	    {
+	        limited.categorical = categorical.data();
+	        categories.assign(count, 0);
+	    }
+
+	    switch (options.criterion)
+	    {
+	    case TreeOptions::Criterion::Entropy:
+	        grow<metrics::Entropy>(limited, depth, seed);
+	        break;
+	    default:
+	        grow<metrics::Gini>(limited, depth, seed);
+	        break;
+	    }
+
+	    compact();
+	    if (options.simplify) simplify();
+	}
+
+	std::vector<uint8_t> DecisionTree::categorical_mask(const SplitContext& ctx) const
+	{
+	    std::vector<uint8_t> mask;
+
+	    for (const int& f : options.categorical_features)
 	    {
-	        StackFrame& frame = stack.top();
-	        const size_t n_samples = frame.samples.size();
-	        const size_t n_features = FEATURES_SIZE;
+	        if (f < 0 || static_cast<size_t>(f) >= ctx.features_size) continue;
 
-	        if (frame.phase == 0)
+	        // Split on bins, a bin's lower edge stands for its code only if the
+	        // bin holds that one value, else training and inference would disagree
+	        if (!ctx.presorted && !(ctx.exact_bins && ctx.exact_bins[f])) continue;
+
+	        // Every value the tree can see must be a code, else the feature stays ordered
+	        const auto code = [&] (const size_t idx) {
+	            return ctx.presorted ? ctx.values(f)[idx] : ctx.edges(f)[ctx.feature(f)[idx]];
+	        };
+
+	        bool codes = true;
+	        if (!rows.empty())
 	        {
-	            size_t m = static_cast<size_t>(std::sqrt(FEATURES_SIZE));
-	            std::vector<int> selected_features(FEATURES_SIZE);
-	            std::iota(selected_features.begin(), selected_features.end(), 0);
-	            std::shuffle(selected_features.begin(), selected_features.end(), rng);
-	            selected_features.resize(m);
-
-	            std::unordered_map<int, int> labels_counts;
-	            for (const auto idx : frame.samples)
-	            {
-	            	++labels_counts[y[idx]];
-	            }
+	            for (const int& idx : rows) codes = codes && metrics::is_category(code(idx));
+	        }
+	        else
+	        {
+	            for (size_t idx = 0; idx < ctx.samples_size; idx++) codes = codes && metrics::is_category(code(idx));
+	        }
+
+	        if (!codes) continue;
+
+	        mask.resize(ctx.features_size, 0);
+	        mask[f] = 1;
+	    }
+
+	    return mask;
+	}
+
+	void DecisionTree::set_presorted(std::vector<int> orders)
+	{
+	    presorted = std::move(orders);
+	}
+
+	DecisionTree::Workspace DecisionTree::prepare(
+	    const SplitContext& ctx,
+	    scratch_vector<int>& samples,
+	    scratch_vector<uint8_t>& goes_left) const
+	{
+	    if (ctx.presorted)
+	    {
+	        samples.assign(ctx.presorted, ctx.presorted + ctx.features_size * ctx.samples_size);
+	        goes_left.resize(ctx.samples_size);
+	    }
+	    else if (!rows.empty())
+	    {
+	        samples.assign(rows.begin(), rows.end());
+
+	        size_t total = rows.size();
+	        if (ctx.class_counts)
+	        {
+	            const int* end = ctx.class_counts + ctx.samples_size * ctx.n_classes;
+	            total = static_cast<size_t>(std::accumulate(ctx.class_counts, end, int64_t(0)));
+	        }
+
+	        return { samples.data(), goes_left.data(), rows.size(), total };
+	    }
+	    else
+	    {
+	        samples.resize(ctx.samples_size);
+	        std::iota(samples.begin(), samples.end(), 0);
+	    }
+
+	    return { samples.data(), goes_left.data(), ctx.samples_size, ctx.samples_size };
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	Split DecisionTree::search_node(
+	    const SplitContext& ctx,
+	    const Workspace& ws,
+	    const OpenNode& open,
+	    const metrics::ClassCounts<Criterion>& counts,
+	    const uint64_t seed,
+	    ScratchArena& arena,
+	    const size_t parallel_threshold,
+	    size_t& split_at) const
+	{
+	    ArenaScope scope(arena);
+
+	    const size_t m = options.max_features > 0
+	        ? std::clamp<size_t>(static_cast<size_t>(std::lround(options.max_features * ctx.features_size)), 1, ctx.features_size)
+	        : static_cast<size_t>(std::sqrt(ctx.features_size));
+	    const size_t n_samples = open.end - open.begin;
+	    int* node_samples = ws.samples + open.begin;
+
+	    streams::Stream rng(seed, open.path);
+	    scratch_vector<int> selected(ctx.features_size, &arena);
+	    std::iota(selected.begin(), selected.end(), 0);
+	    streams::partial_shuffle(selected.data(), ctx.features_size, m, rng);
+
+	    if (!ctx.presorted)
+	    {
+	        Split split = options.split == TreeOptions::SplitMode::Random
+	            ? random_split<Criterion>(ctx, selected.data(), m, node_samples, n_samples, counts, rng, arena)
+	            : find_split<Criterion>(ctx, selected.data(), m, node_samples, n_samples, counts, arena, parallel_threshold);
 
-	            if (frame.depth >= max_depth || labels_counts.size() == 1)
+	        if (split.gain * counts.size() < options.min_impurity_decrease * ws.total) split = Split();
+
+	        if (split.gain > 0 && split.categories)
+	        {
+	            // Bin -> side once, a categorical bin is one code
+	            const float* edges = ctx.edges(split.feature);
+	            bool left_bins[metrics::MAX_BINS];
+	            for (size_t bin = 0; bin < metrics::MAX_BINS; bin++)
 	            {
-	                this->cursor = frame.cursor;
-	                this->add(&DecisionTree::labels, metrics::majority_label(labels_counts));
-	                index = frame.cursor;
-	                stack.pop();
-	                continue;
+	                left_bins[bin] = metrics::in_categories(split.categories, edges[bin]);
 	            }
 
-	            frame.split_gain = 0;
-	            frame.split_feature = -1;
+	            const uint8_t* Xs_binned = ctx.feature(split.feature);
+	            int* mid = std::partition(node_samples, node_samples + n_samples,
+	                [&] (const int idx) { return left_bins[Xs_binned[idx]]; });
+	            split_at = open.begin + (mid - node_samples);
+	        }
+	        else if (split.gain > 0)
+	        {
+	            const uint8_t* Xs_binned = ctx.feature(split.feature);
+	            int* mid = std::partition(node_samples, node_samples + n_samples,
+	                [&] (const int idx) { return Xs_binned[idx] < split.bin; });
+	            split_at = open.begin + (mid - node_samples);
+	        }
 
-	            float parent_gini = metrics::gini(labels_counts);
+	        return split;
+	    }
 
-	        #ifdef __USE_OMP__
-	            #pragma omp parallel
-	            {
-	            	float split_gain = 0.0f;
-	                int split_feature = -1;
-	                float split_threshold = 0.0f;
-	                std::vector<int> split_left, split_right;
-	        #endif
-	                std::unordered_map<int, int> l_counts, r_counts;
-	                std::vector<int> left, binned_indices;
-
-	                left.reserve(n_samples);
-	                binned_indices.reserve(n_samples);
-
-	            #ifdef __USE_OMP__
-	                #pragma omp for schedule(static)
-	            #endif
-	                for (size_t f = 0; f < selected_features.size(); f++)
-	                {
-	                    const int feature = selected_features[f];
-	                    const float* edges = bin_edges.data() + feature * (metrics::MAX_BINS + 1);
-	                    const uint8_t* Xf_binned = X_binned.data() + feature * SAMPLES_SIZE;
-	                    
-	                    left.clear();
-	                    l_counts.clear();
-	                    r_counts = labels_counts;
-
-	      				binned_indices.clear();
-	                    binned_indices.assign(frame.samples.begin(), frame.samples.end());
-	                    std::sort(binned_indices.begin(), binned_indices.end(),
-	                    	[&] (const int i, const int j) {
-	                    		return Xf_binned[i] < Xf_binned[j];
-	                    	});
-	                    
-	                    #pragma omp simd
-	                    for (size_t i = 0; i < n_samples - 1; ++i)
-	                    {
-	                    	if (i + metrics::PREFETCH_DISTANCE < n_samples)
-	                    		__builtin_prefetch(&binned_indices[i + metrics::PREFETCH_DISTANCE], 0, 1);
-
-	                    	const int idx0 = binned_indices[i];
-	                    	const int idx1 = binned_indices[i + 1];
-	                    	const uint8_t bin0 = Xf_binned[idx0];
-	                    	const uint8_t bin1 = Xf_binned[idx1];
-	                        const int moved_label = y[idx0];
-
-	                        left.emplace_back(idx0);
-	                        l_counts[moved_label]++;
-	                        r_counts[moved_label]--;
-
-	                        if (bin0 == bin1) continue;
-	                        if (left.empty() || left.size() >= n_samples) continue;
-
-	                        float threshold = edges[bin1];
-	                        
-	                        const size_t n_left = i + 1;
-	                        const size_t n_right = n_samples - n_left;
-
-	                        float gain = parent_gini
-	                            - (static_cast<float>(n_left) / n_samples)  * metrics::gini(l_counts)
-	                            - (static_cast<float>(n_right) / n_samples) * metrics::gini(r_counts);
-
-	                    #ifdef __USE_OMP__
-	                        if (gain > split_gain) 
-	                        {
-	                            split_gain = gain;
-	                            split_feature = feature;
-	                            split_threshold = threshold;
-	                            split_left = left;
-
-	                            split_right.clear();
-	                            split_right.assign(
-	                            	binned_indices.begin() + n_left, binned_indices.end());
-	                        }
-	                    #else
-	                        if (gain > frame.split_gain) 
-	                        {
-	                            frame.split_gain = gain;
-	                            frame.split_feature = feature;
-	                            frame.split_threshold = threshold;
-	                            frame.split_left = left;
-	                            frame.split_right.clear();
-
-	                            frame.split_right.assign(
-	                            	binned_indices.begin() + n_left, binned_indices.end());
-	                        }
-	                    #endif
-	                    }
-	                }
+	    Split split;
+	    scratch_vector<int> code_hist(&arena);
+	    for (size_t f = 0; f < m; f++)
+	    {
+	        const int* order = ctx.order(ws.samples, selected[f]) + open.begin;
+	        Split candidate;
 
-	            #ifdef __USE_OMP__
-	                #pragma omp critical
-	                {
-	                    if (split_gain > frame.split_gain) 
-	                    {
-	                        frame.split_gain = split_gain;
-	                        frame.split_feature = split_feature;
-	                        frame.split_threshold = split_threshold;
-	                        frame.split_left = std::move(split_left);
-	                        frame.split_right = std::move(split_right);
-	                    }
-	                }
-	            }
-	            #endif
+	        if (ctx.is_categorical(selected[f]))
+	        {
+	            code_hist.resize(metrics::MAX_CATEGORIES * ctx.n_classes);
+	            categories_from_rows(ctx, selected[f], order, n_samples, code_hist.data());
+	            candidate = sweep_categories<Criterion>(ctx, selected[f], code_hist.data(), counts, arena);
+	        }
+	        else
+	        {
+	            candidate = sweep_sorted<Criterion>(ctx, selected[f], order, n_samples, counts, arena);
+	        }
+
+	        if (candidate.gain > split.gain)
+	        {
+	            split = candidate;
+	        }
+	    }
+
+	    if (split.gain * counts.size() < options.min_impurity_decrease * ws.total) split = Split();
+	    if (split.gain == 0) return split;
+
+	    // Stable partition of every feature's order keeps both children sorted
+	    const float* Xs = ctx.values(split.feature);
+	    for (size_t k = 0; k < n_samples; k++)
+	    {
+	        ws.goes_left[node_samples[k]] = split.categories
+	            ? metrics::in_categories(split.categories, Xs[node_samples[k]])
+	            : Xs[node_samples[k]] < split.threshold;
+	    }
+
+	    scratch_vector<int> rights(&arena);
+	    rights.reserve(n_samples);
+
+	    size_t n_left = 0;
+	    for (size_t f = 0; f < ctx.features_size; f++)
+	    {
+	        int* order = ctx.order(ws.samples, f) + open.begin;
+	        size_t w = 0;
+	        rights.clear();
+
+	        for (size_t k = 0; k < n_samples; k++)
+	        {
+	            if (ws.goes_left[order[k]])
+	                order[w++] = order[k];
+	            else
+	                rights.emplace_back(order[k]);
+	        }
+
+	        std::copy(rights.begin(), rights.end(), order + w);
+	        n_left = w;
+	    }
+
+	    split_at = open.begin + n_left;
+	    return split;
+	}
+
+	void DecisionTree::compact()
+	{
+	    // Preorder renumbering: the layout only depends on the tree's shape
+	    std::vector<int> order;
+	    std::vector<int> stack = { 0 };
+	    order.reserve(count);
+
+	    while (!stack.empty())
+	    {
+	        const int node = stack.back();
+	        stack.pop_back();
+	        order.emplace_back(node);
+
+	        if (lefts[node] != -1 || rights[node] != -1)
+	        {
+	            stack.emplace_back(rights[node]);
+	            stack.emplace_back(lefts[node]);
+	        }
+	    }
+
+	    std::vector<int> renumber(count, -1);
+	    for (size_t i = 0; i < order.size(); i++)
+	    {
+	        renumber[order[i]] = static_cast<int>(i);
+	    }
+
+	    const size_t n = order.size();
+	    std::vector<float> c_thresholds(n);
+	    std::vector<int> c_features(n), c_lefts(n), c_rights(n), c_labels(n);
+	    std::vector<uint64_t> c_categories(categories.empty() ? 0 : n);
+	    std::vector<float> c_values(values.empty() ? 0 : n);
 
-	            if (frame.split_gain == 0 || frame.cursor >= count) 
+	    for (size_t i = 0; i < n; i++)
+	    {
+	        const int node = order[i];
+	        c_thresholds[i] = thresholds[node];
+	        c_features[i] = features[node];
+	        c_labels[i] = labels[node];
+	        c_lefts[i] = lefts[node] == -1 ? -1 : renumber[lefts[node]];
+	        c_rights[i] = rights[node] == -1 ? -1 : renumber[rights[node]];
+	        if (!categories.empty()) c_categories[i] = categories[node];
+	        if (!values.empty()) c_values[i] = values[node];
+	    }
+
+	    // Trees without a categorical split keep the plain layout
+	    if (std::all_of(c_categories.begin(), c_categories.end(), [] (const uint64_t c) { return c == 0; }))
+	    {
+	        c_categories.clear();
+	    }
+
+	    thresholds = std::move(c_thresholds);
+	    features = std::move(c_features);
+	    lefts = std::move(c_lefts);
+	    rights = std::move(c_rights);
+	    labels = std::move(c_labels);
+	    categories = std::move(c_categories);
+	    values = std::move(c_values);
+	    count = static_cast<int>(n);
+	    cursor = 0;
+	}
+
+	int DecisionTree::simplify()
+	{
+	    const int before = count;
+	    bool collapsed = false;
+
+	    // Preorder: children come after their parent, a reverse pass sees
+	    // both children final before the parent
+	    for (int node = count - 1; node >= 0; node--)
+	    {
+	        const int l = lefts[node];
+	        const int r = rights[node];
+	        if (l == -1 && r == -1) continue;
+
+	        const bool leaves = lefts[l] == -1 && rights[l] == -1 && lefts[r] == -1 && rights[r] == -1;
+	        if (!leaves || labels[l] != labels[r]) continue;
+	        if (!values.empty() && values[l] != values[r]) continue;
+
+	        labels[node] = labels[l];
+	        if (!values.empty()) values[node] = values[l];
+	        lefts[node] = rights[node] = -1;
+	        collapsed = true;
+	    }
+
+	    if (collapsed) compact();
+	    return before - count;
+	}
+
+	int DecisionTree::prune(const SplitContext& ctx, const std::vector<int>& rows, double alpha)
+	{
+	    const int before = count;
+	    const size_t K = ctx.n_classes;
+
+	    // Held-out weight reaching each node, and its errors if it were a leaf
+	    std::vector<double> reached(count, 0.0), errors(count, 0.0);
+	    for (const int& idx : rows)
+	    {
+	        int node = 0;
+	        while (true)
+	        {
+	            if (ctx.class_counts)
+	            {
+	                const int* row = ctx.class_counts + idx * K;
+	                const int n = std::accumulate(row, row + K, 0);
+	                reached[node] += n;
+	                errors[node] += n - row[labels[node]];
+	            }
+	            else
 	            {
-	                this->cursor = frame.cursor;
-	                this->add(&DecisionTree::labels, metrics::majority_label(labels_counts));
-	                index = frame.cursor;
-	                stack.pop();
-	                continue;
+	                reached[node] += 1.0;
+	                errors[node] += ctx.y[idx] != labels[node];
 	            }
 
-	            frame.index = frame.cursor;
-	            this->cursor = frame.cursor;
-	            this->add(&DecisionTree::features, frame.split_feature);
-	            this->add(&DecisionTree::thresholds, frame.split_threshold);
-	            
-	            frame.l_root = frame.index + 1;
-	            frame.phase = 1;
-	            
-	            StackFrame l_frame;
-	            l_frame.samples  = std::move(frame.split_left);
-	            l_frame.depth    = frame.depth + 1;
-	            l_frame.cursor   = frame.l_root;
-	            l_frame.phase    = 0;
-	            stack.push(l_frame);
+	            if (lefts[node] == -1 && rights[node] == -1) break;
+
+	            const int f = features[node];
+	            node = goes_left(node, ctx.edges(f)[ctx.feature(f)[idx]])
+	                ? lefts[node]
+	                : rights[node];
 	        }
+	    }
+
+	    if (reached[0] == 0.0) return 0;
+
+	    // Bottom-up, each subtree keeps its cheapest pruning:
+	    // cost = error rate + alpha * leaves
+	    const double scale = 1.0 / reached[0];
+	    std::vector<double> cost(count);
+	    bool collapsed = false;
+
+	    for (int node = count - 1; node >= 0; node--)
+	    {
+	        const double as_leaf = errors[node] * scale + alpha;
+	        const int l = lefts[node];
+	        const int r = rights[node];
 
-	        else if (frame.phase == 1)
+	        if (l == -1 && r == -1)
 	        {
-	            frame.index = index;
-	            this->cursor = frame.cursor;
-	            this->add(&DecisionTree::lefts, frame.l_root);
-	            
-	            frame.r_root = frame.index + 1;
-	            frame.phase = 2;
-	            
-	            StackFrame r_frame;
-	            r_frame.samples  = std::move(frame.split_right);
-	            r_frame.depth    = frame.depth + 1;
-	            r_frame.cursor   = frame.r_root;
-	            r_frame.phase    = 0;
-	            stack.push(r_frame);
+	            cost[node] = as_leaf;
+	            continue;
 	        }
 
+	        // No held-out row reaches it: no evidence against the bag's splits
+	        const double as_subtree = cost[l] + cost[r];
+	        if (reached[node] > 0.0 && as_leaf <= as_subtree)
+	        {
+	            lefts[node] = rights[node] = -1;
+	            cost[node] = as_leaf;
+	            collapsed = true;
+	        }
 	        else
 	        {
-	            frame.index = index;
-	            this->cursor = frame.cursor;
-	            this->add(&DecisionTree::rights, frame.r_root);
-	            
-	            index = frame.index;
-	            stack.pop();
+	            cost[node] = as_subtree;
+	        }
+	    }
+
+	    if (collapsed) compact();
+	    return before - count;
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	int DecisionTree::grow(
+	    const SplitContext& ctx,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed)
+	{
+	    switch (options.growth)
+	    {
+	    case TreeOptions::Growth::LevelWise:
+	        return grow_level_wise<Criterion>(ctx, depth, seed);
+	    case TreeOptions::Growth::BestFirst:
+	        return grow_best_first<Criterion>(ctx, depth, seed);
+	    default:
+	        return grow_depth_first<Criterion>(ctx, depth, seed);
+	    }
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	int DecisionTree::grow_depth_first(
+	    const SplitContext& ctx,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed)
+	{
+	    ScratchArena& arena = ScratchArena::local();
+	    ArenaScope tree_scope(arena);
+
+	    // Nodes own contiguous ranges of the workspace, partitioned in place
+	    scratch_vector<int> samples(&arena);
+	    scratch_vector<uint8_t> goes_left(&arena);
+	    const Workspace ws = prepare(ctx, samples, goes_left);
+
+	    std::atomic<int> next_free = cursor + 1;
+	    TaskScheduler::TaskGroup group;
+
+	    grow_subtree<Criterion>(
+	        ctx, { cursor, 0, ws.size, depth.first, 1 }, depth.second,
+	        ws, next_free, group, seed);
+	    group.wait();
+
+	    return std::min(next_free.load(), count) - 1;
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	void DecisionTree::grow_subtree(
+	    const SplitContext& ctx,
+	    const OpenNode root,
+	    const int max_depth,
+	    const Workspace ws,
+	    std::atomic<int>& next_free,
+	    TaskScheduler::TaskGroup& group,
+	    const uint64_t seed)
+	{
+	    ScratchArena& arena = ScratchArena::local();
+	    ArenaScope subtree_scope(arena);
+
+	    scratch_vector<OpenNode> stack(&arena);
+	    metrics::ClassCounts<Criterion> labels_counts(ctx.n_classes, &arena);
+
+	    stack.push_back(root);
+	    while (!stack.empty())
+	    {
+	        const OpenNode open = stack.back();
+	        stack.pop_back();
+
+	        const int* node_samples = ws.samples + open.begin;
+	        const size_t n_samples = open.end - open.begin;
+
+	        labels_counts.clear();
+	        ctx.add_rows(labels_counts, node_samples, n_samples);
+
+	        // Other subtrees may be written concurrently, only touch this node's slots
+	        labels[open.node] = labels_counts.majority();
+	        if (open.depth >= max_depth || labels_counts.pure()) continue;
+
+	        size_t split_at = open.begin;
+	        const Split split = search_node<Criterion>(
+	            ctx, ws, open, labels_counts, seed, arena, options.histogram_threshold, split_at);
+
+	        if (split.gain == 0) continue;
+
+	        const int l_root = next_free.fetch_add(2);
+	        const int r_root = l_root + 1;
+	        if (r_root >= count) continue;
+
+	        features[open.node] = split.feature;
+	        thresholds[open.node] = split.threshold;
+	        if (split.categories) categories[open.node] = split.categories;
+	        lefts[open.node] = l_root;
+	        rights[open.node] = r_root;
+
+	        // Right is pushed first so the left subtree is grown first
+	        const OpenNode children[2] = {
+	            { r_root, split_at, open.end, open.depth + 1, open.path * 2 + 1 },
+	            { l_root, open.begin, split_at, open.depth + 1, open.path * 2 }
+	        };
+
+	        for (const OpenNode& child : children)
+	        {
+	            if (child.end - child.begin >= options.subtree_task_threshold)
+	            {
+	                group.run([=, this, &ctx, &next_free, &group] {
+	                    grow_subtree<Criterion>(ctx, child, max_depth, ws, next_free, group, seed);
+	                });
+	            }
+	            else
+	            {
+	                stack.push_back(child);
+	            }
+	        }
+	    }
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	int DecisionTree::grow_level_wise(
+	    const SplitContext& ctx,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed)
+	{
+	    ScratchArena& arena = ScratchArena::local();
+	    ArenaScope tree_scope(arena);
+
+	    const int max_depth = depth.second;
+
+	    // Nodes own contiguous ranges of the workspace, partitioned in place
+	    scratch_vector<int> samples(&arena);
+	    scratch_vector<uint8_t> goes_left(&arena);
+	    const Workspace ws = prepare(ctx, samples, goes_left);
+
+	    scratch_vector<OpenNode> level(&arena), next(&arena);
+	    scratch_vector<Split> splits(&arena);
+	    scratch_vector<size_t> mids(&arena);
+	    scratch_vector<int> majority(&arena);
+
+	    int next_free = cursor + 1;
+	    level.push_back({ cursor, 0, ws.size, depth.first, 1 });
+
+	    for (int d = depth.first; !level.empty(); ++d)
+	    {
+	        const size_t n_open = level.size();
+	        const bool last_level = d >= max_depth;
+
+	        splits.assign(n_open, Split{});
+	        mids.assign(n_open, 0);
+	        majority.assign(n_open, 0);
+
+	        auto split_node = [&] (const size_t i, const size_t parallel_threshold)
+	        {
+	            ScratchArena& local = ScratchArena::local();
+	            ArenaScope node_scope(local);
+
+	            const OpenNode& open = level[i];
+	            const int* node_samples = ws.samples + open.begin;
+	            const size_t n_samples = open.end - open.begin;
+
+	            metrics::ClassCounts<Criterion> counts(ctx.n_classes, &local);
+	            ctx.add_rows(counts, node_samples, n_samples);
+
+	            majority[i] = counts.majority();
+	            if (last_level || counts.pure()) return;
+
+	            splits[i] = search_node<Criterion>(
+	                ctx, ws, open, counts, seed, local, parallel_threshold, mids[i]);
+	        };
+
+	        // Large nodes take every thread for their histograms, one after the other
+	        for (size_t i = 0; i < n_open; i++)
+	        {
+	            if (level[i].end - level[i].begin >= options.histogram_threshold)
+	            {
+	                split_node(i, options.histogram_threshold);
+	            }
+	        }
+
+	        // The rest are spread over the workers, one node each
+	        TaskScheduler::instance().parallel_for(0, n_open, 1, [&] (const size_t begin, const size_t end) {
+	            for (size_t i = begin; i < end; i++)
+	            {
+	                if (level[i].end - level[i].begin < options.histogram_threshold)
+	                {
+	                    split_node(i, std::numeric_limits<size_t>::max());
+	                }
+	            }
+	        });
+
+	        // Children are numbered in level order, so the layout does not depend on scheduling
+	        next.clear();
+	        for (size_t i = 0; i < n_open; i++)
+	        {
+	            const OpenNode& open = level[i];
+	            this->cursor = open.node;
+	            this->add(&DecisionTree::labels, majority[i]);
+
+	            if (splits[i].gain == 0 || next_free + 1 >= count) continue;
+
+	            const int l_root = next_free++;
+	            const int r_root = next_free++;
+
+	            this->add(&DecisionTree::features, splits[i].feature);
+	            this->add(&DecisionTree::thresholds, splits[i].threshold);
+	            if (splits[i].categories) this->add(&DecisionTree::categories, splits[i].categories);
+	            this->add(&DecisionTree::lefts, l_root);
+	            this->add(&DecisionTree::rights, r_root);
+
+	            next.push_back({ l_root, open.begin, mids[i], d + 1, open.path * 2 });
+	            next.push_back({ r_root, mids[i], open.end, d + 1, open.path * 2 + 1 });
 	        }
+
+	        std::swap(level, next);
 	    }
-	    
-	    return index;
+
+	    return next_free - 1;
 	}
 
 	DecisionTree::~DecisionTree()
 	{
 	}
-}
\ No newline at end of file
+
+	template <metrics::ImpurityCriterion Criterion>
+	int DecisionTree::grow_best_first(
+	    const SplitContext& ctx,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed)
+	{
+	    ScratchArena& arena = ScratchArena::local();
+	    ArenaScope tree_scope(arena);
+
+	    const int max_depth = depth.second;
+	    const size_t max_leaves = options.max_leaf_nodes
+	        ? options.max_leaf_nodes
+	        : std::numeric_limits<size_t>::max();
+
+	    scratch_vector<int> samples(&arena);
+	    scratch_vector<uint8_t> goes_left(&arena);
+	    const Workspace ws = prepare(ctx, samples, goes_left);
+
+	    // Node whose best split is known (and its range partitioned) but not applied yet
+	    struct Candidate
+	    {
+	        OpenNode open;
+	        Split split;
+	        size_t split_at;
+	        float decrease;
+	    };
+
+	    // Max-heap on the impurity decrease, ties to the smaller path
+	    const auto lower = [] (const Candidate& a, const Candidate& b) {
+	        return a.decrease < b.decrease || (a.decrease == b.decrease && a.open.path > b.open.path);
+	    };
+
+	    scratch_vector<Candidate> heap(&arena);
+	    metrics::ClassCounts<Criterion> counts(ctx.n_classes, &arena);
+
+	    const auto evaluate = [&] (const OpenNode& open) {
+	        const int* node_samples = ws.samples + open.begin;
+	        const size_t n_samples = open.end - open.begin;
+
+	        counts.clear();
+	        ctx.add_rows(counts, node_samples, n_samples);
+
+	        labels[open.node] = counts.majority();
+	        if (open.depth >= max_depth || counts.pure()) return;
+
+	        size_t split_at = open.begin;
+	        const Split split = search_node<Criterion>(
+	            ctx, ws, open, counts, seed, arena, options.histogram_threshold, split_at);
+
+	        if (split.gain == 0) return;
+
+	        heap.push_back({ open, split, split_at, split.gain * counts.size() });
+	        std::push_heap(heap.begin(), heap.end(), lower);
+	    };
+
+	    int next_free = cursor + 1;
+	    size_t leaves = 1;
+
+	    evaluate({ cursor, 0, ws.size, depth.first, 1 });
+
+	    while (!heap.empty() && leaves < max_leaves && next_free + 1 < count)
+	    {
+	        std::pop_heap(heap.begin(), heap.end(), lower);
+	        const Candidate best = heap.back();
+	        heap.pop_back();
+
+	        const OpenNode& open = best.open;
+	        const int l_root = next_free;
+	        const int r_root = next_free + 1;
+	        next_free += 2;
+	        ++leaves;
+
+	        features[open.node] = best.split.feature;
+	        thresholds[open.node] = best.split.threshold;
+	        if (best.split.categories) categories[open.node] = best.split.categories;
+	        lefts[open.node] = l_root;
+	        rights[open.node] = r_root;
+
+	        evaluate({ l_root, open.begin, best.split_at, open.depth + 1, open.path * 2 });
+	        evaluate({ r_root, best.split_at, open.end, open.depth + 1, open.path * 2 + 1 });
+	    }
+
+	    return next_free - 1;
+	}
+}
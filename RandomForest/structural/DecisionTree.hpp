@@ -7,21 +7,39 @@
 #include <functional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 #include <concepts>
 #include <iostream>
 #include <unordered_set>
+#include <span>
 #include "../cereal/types/vector.hpp"
-#include "StackFrame.hpp"
+#include "ScratchArena.hpp"
+#include "TreeOptions.hpp"
+#include "SplitSearch.hpp"
+#include "TaskScheduler.hpp"
 #include "IDecisionNode.hpp"
 #include "../algorithm/metrics.hpp"
+#include "../algorithm/streams.hpp"
 
 namespace metrics = epsilon::ml::rf::algorithm::metrics;
+namespace streams = epsilon::ml::rf::algorithm::streams;
 
 namespace epsilon::ml::rf::structural
 {
-	class DecisionTree final : public IDecisionNode
+	class DecisionTree : public IDecisionNode
 	{
 	public:
+		// One stored node, left == right == -1 for a leaf
+		struct NodeView
+		{
+			int feature;
+			float threshold;
+			uint64_t categories;
+			int left;
+			int right;
+			int label;
+		};
+
 		DecisionTree() = default;
 		DecisionTree(const int& n);
 		DecisionTree(const DecisionTree&) = delete;
@@ -29,6 +47,10 @@ namespace epsilon::ml::rf::structural
 
     	void set_cursor(int c);
     	void resize(int c);
+    	void set_options(const TreeOptions& o);
+    	void set_presorted(std::vector<int> orders);
+    	int size() const { return count; }
+    	NodeView node(int i) const;
 
     	void add(auto DecisionTree::* v, auto x)
     		requires std::is_arithmetic_v<decltype(x)>;
@@ -36,6 +58,49 @@ namespace epsilon::ml::rf::structural
 		int predict(const std::vector<float>& data) override;
 		int predict(float* data, size_t size) override;
 
+		/**
+		 * Sample i of a feature-major matrix, stride values per feature.
+		 */
+		int predict_column(const float* X, size_t stride, size_t i) const;
+
+		/**
+		 * Sample i of a binned matrix. A value in bin b routes like the bin's
+		 * lower edge, which is exact for thresholds on bin edges.
+		 */
+		int predict_binned(const SplitContext& ctx, size_t i) const;
+
+		/**
+		 * Leaf value reached by a sample, for trees whose leaves hold scores
+		 * (boosting) rather than labels.
+		 */
+		float predict_value(const float* x) const;
+
+		/**
+		 * Nodes written by an external grower (BoostedTrees), slots of the
+		 * constructor's capacity. compact() then renumbers in preorder and
+		 * drops the slots never reached.
+		 */
+		void set_split(int node, int feature, float threshold, int left, int right);
+		void set_value(int node, float value);
+		void compact();
+
+		/**
+		 * Collapses every split whose two leaves answer the same (label,
+		 * and value if any) until none is left, then renumbers. Predictions
+		 * are unchanged. Returns the number of nodes removed.
+		 */
+		int simplify();
+
+		/**
+		 * Cost-complexity pruning on held-out rows of a binned dataset
+		 * (weighted rows count with their class counts): a subtree becomes
+		 * a leaf unless its held-out error rate is lower than the leaf's by
+		 * more than alpha per extra leaf. alpha = 0 keeps only the splits
+		 * that help on these rows. Subtrees no held-out row reaches are
+		 * kept. Returns the number of nodes removed.
+		 */
+		int prune(const SplitContext& ctx, const std::vector<int>& rows, double alpha);
+
 		int build(
 		    const std::vector<float>& X,
 		    const std::vector<int>& y,
@@ -43,10 +108,20 @@ namespace epsilon::ml::rf::structural
 		    const std::pair<int, int>& depth,
 		    std::mt19937& rng = internal_rng()) override;
 
+		/**
+		 * Grows the tree on an already binned dataset over the given rows,
+		 * repeats allowed (a bootstrap draw). Neither is copied.
+		 */
+		int build(
+		    const SplitContext& ctx,
+		    const std::vector<int>& rows,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng);
+
 		void print(int node = 0, int depth = 0) const;
 
 		template <class Archive>
-		void serialize(Archive & ar)
+		void serialize(Archive & ar, const std::uint32_t version)
 		{
 			ar(
 				thresholds,
@@ -56,20 +131,137 @@ namespace epsilon::ml::rf::structural
 				labels,
 				count,
 				cursor);
+
+			// 1: categorical splits, 2: leaf values
+			if (version >= 1) ar(categories);
+			if (version >= 2) ar(values);
 		}
 
 		~DecisionTree();
 
 	private:
+		// Node being grown, its samples are samples[begin, end).
+		// path is the heap index (root 1, children 2p and 2p + 1), it keys
+		// the node's random stream independently of where the node is stored.
+		struct OpenNode
+		{
+			int node;
+			size_t begin;
+			size_t end;
+			int depth;
+			uint64_t path;
+		};
+
+		// Per-build buffers shared by every node and task of the tree.
+		// samples holds one index array (histogram mode) or one presorted
+		// order per feature, features x samples (exact mode). size is the
+		// root's range, the rows of a binned build or every sample. total
+		// is the root's weight, size unless rows carry class counts.
+		struct Workspace
+		{
+			int* samples;
+			uint8_t* goes_left;
+			size_t size;
+			size_t total;
+		};
+
+		// Categorical node: its codes go left. Otherwise value < threshold.
+		bool goes_left(int node, float value) const
+		{
+			const uint64_t codes = categories.empty() ? 0 : categories[node];
+			return codes ? metrics::in_categories(codes, value) : value < thresholds[node];
+		}
+
+		// TreeOptions::categorical_features that only hold codes, empty if none
+		std::vector<uint8_t> categorical_mask(const SplitContext& ctx) const;
+
+		void grow_tree(
+		    const SplitContext& ctx,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng);
+
+		Workspace prepare(
+		    const SplitContext& ctx,
+		    scratch_vector<int>& samples,
+		    scratch_vector<uint8_t>& goes_left) const;
+
+		template <metrics::ImpurityCriterion Criterion>
+		Split search_node(
+		    const SplitContext& ctx,
+		    const Workspace& ws,
+		    const OpenNode& open,
+		    const metrics::ClassCounts<Criterion>& counts,
+		    const uint64_t seed,
+		    ScratchArena& arena,
+		    const size_t parallel_threshold,
+		    size_t& split_at) const;
+
+		template <metrics::ImpurityCriterion Criterion>
+		int grow(
+		    const SplitContext& ctx,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed);
+
+		template <metrics::ImpurityCriterion Criterion>
+		int grow_depth_first(
+		    const SplitContext& ctx,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed);
+
+		template <metrics::ImpurityCriterion Criterion>
+		void grow_subtree(
+		    const SplitContext& ctx,
+		    const OpenNode root,
+		    const int max_depth,
+		    const Workspace ws,
+		    std::atomic<int>& next_free,
+		    TaskScheduler::TaskGroup& group,
+		    const uint64_t seed);
+
+		template <metrics::ImpurityCriterion Criterion>
+		int grow_level_wise(
+		    const SplitContext& ctx,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed);
+
+		template <metrics::ImpurityCriterion Criterion>
+		int grow_best_first(
+		    const SplitContext& ctx,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed);
+
 		std::vector<float> thresholds;
 		std::vector<int> features;
 		std::vector<int> lefts;
 		std::vector<int> rights;
 		std::vector<int> labels;
+		std::vector<uint64_t> categories;  // per node, empty without categorical splits
+		std::vector<float> values;         // per node, empty unless leaves hold scores
 		std::vector<int> boot;
+		std::vector<int> presorted;
+		std::span<const int> rows;
 		int count = 0;
 		int cursor = 0;
+		TreeOptions options;
+	};
+
+	/**
+	 * A tree as archived before DecisionTree carried a version: the same
+	 * nodes, no categories nor leaf values. It is registered under the
+	 * name DecisionTree had then (cereal_registrer.cpp), so those models
+	 * still load, and saves back in that layout.
+	 */
+	class LegacyDecisionTree final : public DecisionTree
+	{
+	public:
+		template <class Archive>
+		void serialize(Archive & ar)
+		{
+			DecisionTree::serialize(ar, 0);
+		}
 	};
 }
 
+CEREAL_CLASS_VERSION(epsilon::ml::rf::structural::DecisionTree, 2)
+
 #endif
\ No newline at end of file
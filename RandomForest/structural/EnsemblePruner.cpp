@@ -0,0 +1,147 @@
+#include "EnsemblePruner.hpp"
+#include "TaskScheduler.hpp"
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	namespace
+	{
+		struct Score
+		{
+			size_t agree = 0;
+			size_t correct = 0;
+		};
+
+		// Majority of votes plus one for label, ties to the lowest label
+		// as metrics::majority_label
+		inline int majority_with(const int* votes, size_t n_classes, int label)
+		{
+			int best = 0;
+			int best_n = votes[0] + (label == 0);
+			for (size_t k = 1; k < n_classes; k++)
+			{
+				const int n = votes[k] + (label == static_cast<int>(k));
+				if (n > best_n)
+				{
+					best = static_cast<int>(k);
+					best_n = n;
+				}
+			}
+
+			return best;
+		}
+	}
+
+	EnsemblePruner::EnsemblePruner(const FastForest& forest, const float* X, size_t stride, const int* y, size_t n)
+		: forest(forest), y(y, y + n), n_rows(n)
+	{
+		const size_t n_trees = forest.nodes.size();
+		predictions.resize(n_trees * n);
+
+		TaskScheduler::instance().parallel_for(0, n_trees, 1, [&] (const size_t begin, const size_t end) {
+			for (size_t t = begin; t < end; t++)
+			{
+				int* out = predictions.data() + t * n;
+				FastForest::visit(*forest.nodes[t], [&] (const auto& tree) {
+					for (size_t i = 0; i < n; i++) out[i] = tree.predict_column(X, stride, i);
+				});
+			}
+		});
+
+		int top = 0;
+		for (const int& p : predictions) top = std::max(top, p);
+		for (size_t i = 0; i < n; i++) top = std::max(top, y[i]);
+		n_classes = static_cast<size_t>(top) + 1;
+
+		std::vector<int> votes(n_classes);
+		reference.resize(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			std::fill(votes.begin(), votes.end(), 0);
+			for (size_t t = 0; t < n_trees; t++) ++votes[predictions[t * n + i]];
+			reference[i] = metrics::majority_label(votes.data(), n_classes);
+		}
+	}
+
+	EnsemblePruner::Result EnsemblePruner::run(const Target& target) const
+	{
+		const size_t n_trees = forest.nodes.size();
+		const size_t K = n_classes;
+
+		Result result;
+		if (n_trees == 0 || n_rows == 0) return result;
+
+		size_t full_correct = 0;
+		for (size_t i = 0; i < n_rows; i++) full_correct += reference[i] == y[i];
+		result.full_accuracy = static_cast<double>(full_correct) / n_rows;
+
+		const auto met = [&] (const double agreement, const double accuracy) {
+			return (target.agreement > 0 && agreement >= target.agreement)
+				|| (target.tolerance >= 0 && accuracy >= result.full_accuracy - target.tolerance);
+		};
+
+		std::vector<int> votes(n_rows * K, 0);
+		std::vector<uint8_t> picked(n_trees, 0);
+		std::vector<Score> scores(n_trees);
+
+		for (size_t step = 0; step < n_trees; step++)
+		{
+			TaskScheduler::instance().parallel_for(0, n_trees, 1, [&] (const size_t begin, const size_t end) {
+				for (size_t t = begin; t < end; t++)
+				{
+					if (picked[t]) continue;
+
+					const int* p = predictions.data() + t * n_rows;
+					Score score;
+					for (size_t i = 0; i < n_rows; i++)
+					{
+						const int label = majority_with(votes.data() + i * K, K, p[i]);
+						score.agree += label == reference[i];
+						score.correct += label == y[i];
+					}
+
+					scores[t] = score;
+				}
+			});
+
+			// Most agreement, then accuracy, then the older tree
+			size_t best = n_trees;
+			for (size_t t = 0; t < n_trees; t++)
+			{
+				if (picked[t]) continue;
+				if (best == n_trees
+					|| scores[t].agree > scores[best].agree
+					|| (scores[t].agree == scores[best].agree && scores[t].correct > scores[best].correct))
+				{
+					best = t;
+				}
+			}
+
+			picked[best] = 1;
+			const int* p = predictions.data() + best * n_rows;
+			for (size_t i = 0; i < n_rows; i++) ++votes[i * K + p[i]];
+
+			const double agreement = static_cast<double>(scores[best].agree) / n_rows;
+			const double accuracy = static_cast<double>(scores[best].correct) / n_rows;
+			result.trees.push_back(best);
+			result.agreement.push_back(agreement);
+			result.accuracy.push_back(accuracy);
+
+			if (met(agreement, accuracy)) break;
+		}
+
+		return result;
+	}
+
+	std::unique_ptr<FastForest> EnsemblePruner::reduce(const Result& result) const
+	{
+		auto reduced = std::make_unique<FastForest>(0);
+		for (const size_t& t : result.trees)
+		{
+			reduced->nodes.push_back(forest.nodes[t]);
+		}
+
+		reduced->count = reduced->nodes.size();
+		return reduced;
+	}
+}
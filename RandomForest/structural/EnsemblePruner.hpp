@@ -0,0 +1,61 @@
+#ifndef __ML_RF_STRUCTURAL_ENSEMBLE_PRUNER__
+#define __ML_RF_STRUCTURAL_ENSEMBLE_PRUNER__
+
+#include <vector>
+#include <memory>
+#include "FastForest.hpp"
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Smallest subset of a trained forest that votes like the whole forest
+	 * on a validation set. Trees are picked greedily, each one the tree
+	 * whose vote, added to those already picked, agrees with the full
+	 * forest on the most rows, until the target is met.
+	 */
+	class EnsemblePruner
+	{
+	public:
+		struct Target
+		{
+			double agreement = 0.999;  // share of rows voted like the full forest, 0 disables
+			double tolerance = -1.0;   // accuracy below the full forest's, < 0 disables
+		};
+
+		struct Result
+		{
+			std::vector<size_t> trees;      // picked, in order
+			std::vector<double> agreement;  // of the first k + 1 picked trees
+			std::vector<double> accuracy;
+			double full_accuracy = 0.0;
+		};
+
+		/**
+		 * Validation rows [0, n) of a feature-major matrix, stride values
+		 * per feature, as MappedDataset columns. Every tree's vote is
+		 * computed once here.
+		 */
+		EnsemblePruner(const FastForest& forest, const float* X, size_t stride, const int* y, size_t n);
+
+		/**
+		 * Stops at the first subset meeting either enabled criterion, all
+		 * trees if neither is.
+		 */
+		Result run(const Target& target) const;
+
+		/**
+		 * The picked trees, shared with the original forest.
+		 */
+		std::unique_ptr<FastForest> reduce(const Result& result) const;
+
+	private:
+		const FastForest& forest;
+		std::vector<int> y;
+		std::vector<int> predictions;  // trees x rows
+		std::vector<int> reference;    // full forest vote
+		size_t n_rows = 0;
+		size_t n_classes = 0;
+	};
+}
+
+#endif
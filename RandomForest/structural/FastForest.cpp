@@ -3,6 +3,13 @@
 #include <unordered_map>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <ctime>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <iterator>
+#include <cmath>
 
 #ifdef __USE_OMP__
 	#include <omp.h>
@@ -10,11 +17,192 @@
 
 namespace epsilon::ml::rf::structural
 {
+	namespace
+	{
+		// A binary tree never needs more than 2N - 1 nodes, nor more than a
+		// full tree of the depth budget. Node ids are int.
+		size_t tree_capacity(size_t rows, int max_depth)
+		{
+			const int levels = std::clamp(max_depth + 1, 1, 62);
+			return std::min({ 2 * std::max<size_t>(rows, 1) - 1, (size_t(1) << levels) - 1,
+				static_cast<size_t>(std::numeric_limits<int>::max()) });
+		}
+
+		/**
+		 * fn(row) for n uniform draws over [0, n_rows), in ascending order.
+		 * Sorted uniforms are the running sums of n + 1 exponential spacings
+		 * over their total: the stream is read twice (total, then sums) and
+		 * nothing of size n is kept.
+		 */
+		template <class F>
+		void sorted_draws(uint64_t n, uint64_t n_rows, const streams::Stream& stream, F&& fn)
+		{
+			const auto spacing = [&] (const uint64_t i) {
+				return -std::log((static_cast<double>(stream.at(i) >> 11) + 1.0) * 0x1.0p-53);
+			};
+
+			double total = 0.0;
+			for (uint64_t i = 0; i <= n; i++) total += spacing(i);
+
+			// Same additions in the same order, sums never pass total
+			double sum = 0.0;
+			for (uint64_t i = 0; i < n; i++)
+			{
+				sum += spacing(i);
+				fn(std::min(static_cast<uint64_t>(sum / total * static_cast<double>(n_rows)), n_rows - 1));
+			}
+		}
+
+		// Bag of a tree over a set too large for int rows
+		struct GlobalBag
+		{
+			std::vector<uint64_t> ids;  // distinct rows drawn, ascending
+			std::vector<int> boot;      // rows of the gathered ids, one per draw (weighted: per id)
+			std::vector<int> counts;    // weighted: ids.size() x n_classes drawn counts
+		};
+
+		/**
+		 * n draws with replacement over every row, 64-bit ids. Weighted rows
+		 * are drawn as the rows they stand for, cell (row, class) spanning
+		 * [offsets[row * K + k], offsets[row * K + k + 1]), and counted back
+		 * per cell: memory follows the distinct rows, not the draws.
+		 */
+		GlobalBag draw_bag(const BinnedDataset& data, const std::vector<uint64_t>& offsets, size_t n, uint64_t seed, uint64_t tree)
+		{
+			const size_t K = data.n_classes;
+			GlobalBag bag;
+
+			if (offsets.empty())
+			{
+				bag.boot.reserve(n);
+				sorted_draws(n, data.samples_size, streams::Stream(seed, tree), [&] (const uint64_t row) {
+					if (bag.ids.empty() || bag.ids.back() != row) bag.ids.emplace_back(row);
+					bag.boot.emplace_back(static_cast<int>(bag.ids.size() - 1));
+				});
+
+				return bag;
+			}
+
+			std::vector<int> drawn(data.samples_size * K);
+			metrics::bootstrap_counts(offsets.data(), drawn.size(), std::min<uint64_t>(n, offsets.back()), seed, tree, drawn.data());
+
+			for (size_t r = 0; r < data.samples_size; r++)
+			{
+				const int* drawn_r = drawn.data() + r * K;
+				if (std::all_of(drawn_r, drawn_r + K, [] (const int c) { return c == 0; })) continue;
+
+				bag.ids.emplace_back(r);
+				bag.counts.insert(bag.counts.end(), drawn_r, drawn_r + K);
+			}
+
+			bag.boot.resize(bag.ids.size());
+			std::iota(bag.boot.begin(), bag.boot.end(), 0);
+			return bag;
+		}
+
+		// Distinct rows of up to n draws, none of them in bag (ascending), to prune on
+		std::vector<uint64_t> draw_held(uint64_t n_rows, size_t n, const streams::Stream& stream, const std::vector<uint64_t>& bag)
+		{
+			std::vector<uint64_t> held;
+			size_t j = 0;
+			sorted_draws(n, n_rows, stream, [&] (const uint64_t row) {
+				while (j < bag.size() && bag[j] < row) j++;
+				if (j < bag.size() && bag[j] == row) return;
+				if (held.empty() || held.back() != row) held.emplace_back(row);
+			});
+
+			return held;
+		}
+	}
+
 	FastForest::FastForest(size_t c) : count(c)
 	{
 		nodes.resize(c);
 	}
 
+	void FastForest::set_options(const TreeOptions& o)
+	{
+		options = o;
+	}
+
+	void FastForest::merge(FastForest&& other)
+	{
+	    nodes.insert(nodes.end(),
+	        std::make_move_iterator(other.nodes.begin()),
+	        std::make_move_iterator(other.nodes.end()));
+	    count = nodes.size();
+
+	    // Votes of the merged trees are not known here
+	    oob = OutOfBag();
+
+	    other.nodes.clear();
+	    other.count = 0;
+	}
+
+	size_t FastForest::simplify()
+	{
+	    std::atomic<size_t> removed = 0;
+
+	    TaskScheduler::instance().parallel_for(0, nodes.size(), 1, [&] (const size_t begin, const size_t end) {
+	        for (size_t c = begin; c < end; c++)
+	        {
+	            if (auto* tree = dynamic_cast<DecisionTree*>(nodes[c].get()))
+	            {
+	                removed += static_cast<size_t>(tree->simplify());
+	            }
+	        }
+	    });
+
+	    return removed;
+	}
+
+	int FastForest::build(
+	    const BinnedDataset& data,
+	    const std::vector<int>& rows,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed)
+	{
+	    if (data.samples_size > static_cast<size_t>(std::numeric_limits<int>::max()))
+	    {
+	        throw std::length_error("FastForest: rows are int, this set has more than 2^31 - 1");
+	    }
+
+	    nodes.resize(count);
+	    grow_trees(data, depth, seed, 0, count, 0, rows);
+	    return 0;
+	}
+
+	int FastForest::predict_binned(const SplitContext& ctx, size_t i) const
+	{
+		std::vector<int> votes(ctx.n_classes, 0);
+		for (const auto& node : nodes)
+		{
+			++votes[visit(*node, [&] (const auto& tree) { return tree.predict_binned(ctx, i); })];
+		}
+
+		return metrics::majority_label(votes.data(), votes.size());
+	}
+
+	int FastForest::extend(
+	    const BinnedDataset& data,
+	    const std::pair<int, int>& depth,
+	    const size_t n_trees,
+	    const size_t drop_oldest,
+	    std::mt19937& rng)
+	{
+	    FastForest grown(n_trees);
+	    grown.set_options(options);
+	    grown.build(data, depth, rng);
+
+	    const size_t dropped = std::min(drop_oldest, nodes.size());
+	    nodes.erase(nodes.begin(), nodes.begin() + dropped);
+
+	    // Votes of the new trees only, see the header
+	    merge(std::move(grown));
+	    oob = std::move(grown.oob);
+	    return 0;
+	}
+
 	int FastForest::predict(const std::vector<float>& data)
 	{
 		std::unordered_map<int, int> freq;
@@ -24,9 +212,10 @@ namespace epsilon::ml::rf::structural
 			++freq[p];
 		}
 
+		// Ties to the lowest label, as metrics::majority_label
 		return std::max_element(freq.begin(), freq.end(),
 			[](const auto& a, const auto& b) {
-				return a.second < b.second;
+				return a.second < b.second || (a.second == b.second && a.first > b.first);
 			})->first;
 	}
 
@@ -39,9 +228,10 @@ namespace epsilon::ml::rf::structural
 			++freq[p];
 		}
 
+		// Ties to the lowest label, as metrics::majority_label
 		return std::max_element(freq.begin(), freq.end(),
 			[](const auto& a, const auto& b) {
-				return a.second < b.second;
+				return a.second < b.second || (a.second == b.second && a.first > b.first);
 			})->first;
 	}
 
@@ -52,66 +242,410 @@ namespace epsilon::ml::rf::structural
 	    const std::pair<int, int>& depth,
 	    std::mt19937& rng)
 	{
-	    int max_depth = depth.second;
 	    const size_t FEATURES_SIZE = size.first;
 	    const size_t SAMPLES_SIZE = size.second;
-	    const size_t TREES_SIZE = (1 << max_depth) - 1;
+	    // Slots only run out for an explicit depth budget, never depending on scheduling
+	    const size_t TREES_SIZE = tree_capacity(SAMPLES_SIZE, depth.second);
+
+	    if (SAMPLES_SIZE > static_cast<size_t>(std::numeric_limits<int>::max()))
+	    {
+	        throw std::length_error("FastForest: more than 2^31 - 1 rows, build from a BinnedDataset");
+	    }
+
 	    nodes.resize(count);
-	    
-	#ifdef __USE_OMP__
-	    #pragma omp parallel
+
+	    // The caller's engine is read once, trees use streams of (seed, tree)
+	    const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+
+	    if (options.out_of_bag)
 	    {
-	        std::vector<float> X_boot(FEATURES_SIZE * SAMPLES_SIZE);
-	        std::vector<int> y_boot(SAMPLES_SIZE);
-	        #pragma omp for schedule(dynamic)
-	#endif
-	        for (size_t c = 0; c < count; c++)
-	        {
-	    #ifndef __USE_OMP__
+	        oob.reset(SAMPLES_SIZE, static_cast<size_t>(*std::max_element(y.begin(), y.end()) + 1));
+	    }
+
+	    // Exact mode sorts the features once, trees derive their bootstrap orders
+	    std::vector<int> orders;
+	    if (options.split == TreeOptions::SplitMode::Exact && options.growth != TreeOptions::Growth::Oblivious)
+	    {
+	        orders = metrics::argsort_t(X, size);
+	    }
+
+	    // One task per tree, their large subtrees are stolen by idle workers
+	    TaskScheduler::TaskGroup group;
+	    for (size_t c = 0; c < count; c++)
+	    {
+	        group.run([&, c] {
+	            const uint64_t tree_seed = streams::derive(seed, c);
+	            std::seed_seq seq = { static_cast<uint32_t>(tree_seed), static_cast<uint32_t>(tree_seed >> 32) };
+	            std::mt19937 tree_rng(seq);
 	            std::vector<float> X_boot(FEATURES_SIZE * SAMPLES_SIZE);
 	            std::vector<int> y_boot(SAMPLES_SIZE);
-	    #endif
-	            std::shared_ptr<DecisionTree> node = std::make_shared<DecisionTree>(TREES_SIZE);
-	            std::vector<int> boot = metrics::bootstrap(SAMPLES_SIZE, rng);
 
-	            constexpr size_t PREFETCH_DISTANCE = 16;
-	            #pragma omp simd
-	            for (size_t f = 0; f < FEATURES_SIZE; f++)
-	            {
-	                const float* Xf_src = X.data() + f * SAMPLES_SIZE;
-	                float* Xf_boot = X_boot.data() + f * SAMPLES_SIZE;
+	            const auto train = [&] (auto node) {
+	                node->set_options(options);
+	                std::vector<int> boot = metrics::bootstrap(SAMPLES_SIZE, seed, c);
+
+	                if constexpr (std::is_same_v<decltype(node), std::shared_ptr<DecisionTree>>)
+	                {
+	                    if (!orders.empty()) node->set_presorted(metrics::bootstrap_orders(orders, boot, size));
+	                }
+
+	                constexpr size_t PREFETCH_DISTANCE = 16;
+	                for (size_t f = 0; f < FEATURES_SIZE; f++)
+	                {
+	                    const float* Xf_src = X.data() + f * SAMPLES_SIZE;
+	                    float* Xf_boot = X_boot.data() + f * SAMPLES_SIZE;
 	                
+	                    #pragma omp simd
+	                    for (size_t i = 0; i < SAMPLES_SIZE; i++)
+	                    {
+	                    	if (i + PREFETCH_DISTANCE < SAMPLES_SIZE)
+	                    		__builtin_prefetch(&Xf_src[boot[i + PREFETCH_DISTANCE]], 0, 1);
+	                        Xf_boot[i] = Xf_src[boot[i]];
+	                    }
+	                }
+	            
 	                #pragma omp simd
 	                for (size_t i = 0; i < SAMPLES_SIZE; i++)
 	                {
 	                	if (i + PREFETCH_DISTANCE < SAMPLES_SIZE)
-	                		__builtin_prefetch(&Xf_src[boot[i + PREFETCH_DISTANCE]], 0, 1);
-	                    Xf_boot[i] = Xf_src[boot[i]];
+	                    	__builtin_prefetch(&y[boot[i + PREFETCH_DISTANCE]], 0, 1);
+	                    y_boot[i] = y[boot[i]];
 	                }
-	            }
 	            
-	            #pragma omp simd
-	            for (size_t i = 0; i < SAMPLES_SIZE; i++)
-	            {
-	            	if (i + PREFETCH_DISTANCE < SAMPLES_SIZE)
-	                	__builtin_prefetch(&y[boot[i + PREFETCH_DISTANCE]], 0, 1);
-	                y_boot[i] = y[boot[i]];
-	            }
-	            
-	            node->build(
-	                std::move(X_boot),
-	                std::move(y_boot),
-	                size,
-	                depth,
-	                rng);
-	            nodes[c] = std::move(node);
+	                node->build(
+	                    std::move(X_boot),
+	                    std::move(y_boot),
+	                    size,
+	                    depth,
+	                    tree_rng);
+
+	                if (options.out_of_bag)
+	                {
+	                    const std::vector<uint64_t> bag = in_bag(boot, SAMPLES_SIZE);
+	                    for (size_t i = 0; i < SAMPLES_SIZE; i++)
+	                    {
+	                        if (!is_in_bag(bag, i)) oob.vote(i, node->predict_column(X.data(), SAMPLES_SIZE, i));
+	                    }
+	                }
+
+	                nodes[c] = std::move(node);
+	            };
+
+	            if (options.growth == TreeOptions::Growth::Oblivious)
+	                train(std::make_shared<ObliviousTree>());
+	            else
+	                train(std::make_shared<DecisionTree>(TREES_SIZE));
+	        });
+	    }
+	    group.wait();
+
+	    if (options.out_of_bag) oob.finalize(y.data());
+
+	    return 0;
+	}
+
+	int FastForest::build(
+	    const BinnedDataset& data,
+	    const std::pair<int, int>& depth,
+	    std::mt19937& rng)
+	{
+	    const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+	    return build(data, depth, seed, 0, count);
+	}
+
+	int FastForest::build(
+	    const BinnedDataset& data,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed,
+	    const size_t first,
+	    const size_t last)
+	{
+	    const bool vote = options.out_of_bag && !data.weighted();
+	    count = last - first;
+	    nodes.resize(count);
+
+	    if (vote) oob.reset(data.samples_size, data.n_classes);
+
+	    grow_trees(data, depth, seed, first, last, 0);
+
+	    if (vote) oob.finalize(data.y.data());
+
+	    return 0;
+	}
+
+	int FastForest::build(
+	    const BinnedDataset& data,
+	    const std::pair<int, int>& depth,
+	    const Budget& budget,
+	    std::mt19937& rng)
+	{
+	    using clock = std::chrono::steady_clock;
+
+	    const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+	    const size_t batch = budget.batch ? budget.batch : TaskScheduler::instance().size();
+	    const size_t max_trees = budget.max_trees ? budget.max_trees : std::numeric_limits<size_t>::max();
+	    const bool vote = options.out_of_bag && !data.weighted();
+	    const bool plateau = budget.patience > 0 && vote;
+
+	    const auto wall_start = clock::now();
+	    const std::clock_t cpu_start = std::clock();
+
+	    const auto wall_used = [&] { return std::chrono::duration<double>(clock::now() - wall_start).count(); };
+	    const auto cpu_used = [&] { return static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC; };
+
+	    nodes.clear();
+	    count = 0;
+	    if (vote) oob.reset(data.samples_size, data.n_classes);
+
+	    double best_accuracy = 0.0;
+	    size_t stale = 0;
+
+	    while (count < max_trees)
+	    {
+	        const size_t first = count;
+	        const size_t last = std::min(first + batch, max_trees);
+
+	        // Stop before a batch that would overrun, judging by the average so far
+	        if (count > 0)
+	        {
+	            const double per_tree = wall_used() / count;
+	            const double per_tree_cpu = cpu_used() / count;
+	            if (budget.wall_seconds > 0 && wall_used() + per_tree * (last - first) > budget.wall_seconds) break;
+	            if (budget.cpu_seconds > 0 && cpu_used() + per_tree_cpu * (last - first) > budget.cpu_seconds) break;
+	        }
+
+	        nodes.resize(last);
+	        grow_trees(data, depth, seed, first, last, first);
+	        count = last;
+
+	        if (!plateau || count < budget.min_trees) continue;
+
+	        oob.finalize(data.y.data());
+	        if (oob.accuracy > best_accuracy + budget.tolerance)
+	        {
+	            best_accuracy = oob.accuracy;
+	            stale = 0;
+	        }
+	        else if (++stale >= budget.patience)
+	        {
+	            break;
 	        }
-	#ifdef __USE_OMP__
 	    }
-	#endif
+
+	    if (vote) oob.finalize(data.y.data());
+
 	    return 0;
 	}
 
+	void FastForest::grow_trees(
+	    const BinnedDataset& data,
+	    const std::pair<int, int>& depth,
+	    const uint64_t seed,
+	    const size_t first,
+	    const size_t last,
+	    const size_t slot,
+	    std::span<const int> rows)
+	{
+	    const size_t SAMPLES_SIZE = data.samples_size;
+	    const size_t ROWS_SIZE = rows.empty() ? SAMPLES_SIZE : rows.size();
+	    const size_t N_CLASSES = data.n_classes;
+	    const bool vote = options.out_of_bag && rows.empty() && !data.weighted();
+
+	    const SplitContext ctx = data.context();
+
+	    // Trees index rows with int. Past block_rows rows, or 2^31 rows
+	    // stood for by weighted ones, each tree draws its bag over the whole
+	    // set with 64-bit ids and trains on a gathered copy of it instead
+	    const size_t block_rows = std::clamp<size_t>(options.block_rows, 1, std::numeric_limits<int>::max());
+	    std::vector<uint64_t> weight_offsets;
+	    bool sampled = false;
+
+	    if (rows.empty() && data.weighted())
+	    {
+	        weight_offsets.assign(SAMPLES_SIZE * N_CLASSES + 1, 0);
+	        for (size_t i = 0; i < SAMPLES_SIZE * N_CLASSES; i++)
+	        {
+	            weight_offsets[i + 1] = weight_offsets[i] + static_cast<uint64_t>(data.class_counts[i]);
+	        }
+
+	        sampled = SAMPLES_SIZE > block_rows || weight_offsets.back() > static_cast<uint64_t>(std::numeric_limits<int>::max());
+	        if (!sampled) weight_offsets.clear();
+	    }
+	    else if (rows.empty())
+	    {
+	        sampled = SAMPLES_SIZE > block_rows;
+	    }
+
+	    // Weighted rows: the rows they stand for, laid out by (row, class),
+	    // are bootstrapped as such and counted back per row and class
+	    std::vector<int> offsets;
+	    if (data.weighted() && !sampled)
+	    {
+	        offsets.assign(ROWS_SIZE * N_CLASSES + 1, 0);
+	        for (size_t r = 0; r < ROWS_SIZE; r++)
+	        {
+	            const size_t row = rows.empty() ? r : rows[r];
+	            std::copy_n(data.class_counts.data() + row * N_CLASSES, N_CLASSES, offsets.begin() + r * N_CLASSES + 1);
+	        }
+
+	        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	    }
+
+	    TaskScheduler::TaskGroup group;
+	    for (size_t c = first; c < last; c++)
+	    {
+	        group.run([&, c] {
+	            const uint64_t tree_seed = streams::derive(seed, c);
+	            std::seed_seq seq = { static_cast<uint32_t>(tree_seed), static_cast<uint32_t>(tree_seed >> 32) };
+	            std::mt19937 tree_rng(seq);
+
+	            // Sampled trees train on a copy of the distinct rows they drew
+	            GlobalBag bag;
+	            BinnedDataset block;
+	            if (sampled)
+	            {
+	                bag = draw_bag(data, weight_offsets, block_rows, seed, c);
+	                block = data.gather(bag.ids);
+	                if (data.weighted()) block.class_counts = std::move(bag.counts);
+	            }
+
+	            const auto train = [&] (auto node) {
+	                node->set_options(options);
+
+	                // Cost-complexity pruning on what the bootstrap left out
+	                const auto prune = [&] (const SplitContext& held_ctx, const std::vector<int>& held) {
+	                    if constexpr (std::is_same_v<decltype(node), std::shared_ptr<DecisionTree>>)
+	                    {
+	                        if (options.prune_alpha < 0 || held.empty()) return;
+	                        node->prune(held_ctx, held, options.prune_alpha);
+	                        if (options.simplify) node->simplify();
+	                    }
+	                };
+
+	                if (sampled)
+	                {
+	                    node->build(block.context(), bag.boot, depth, tree_rng);
+	                    block = BinnedDataset();
+	                    bag.boot = std::vector<int>();
+
+	                    if (options.prune_alpha >= 0)
+	                    {
+	                        const BinnedDataset held = data.gather(draw_held(SAMPLES_SIZE, block_rows, streams::Stream(seed, c, 1), bag.ids));
+	                        std::vector<int> held_rows(held.samples_size);
+	                        std::iota(held_rows.begin(), held_rows.end(), 0);
+	                        prune(held.context(), held_rows);
+	                    }
+
+	                    // Every row but the drawn ones, walking both in order
+	                    if (vote)
+	                    {
+	                        size_t j = 0;
+	                        for (size_t i = 0; i < SAMPLES_SIZE; i++)
+	                        {
+	                            while (j < bag.ids.size() && bag.ids[j] < i) j++;
+	                            if (j < bag.ids.size() && bag.ids[j] == i) continue;
+	                            oob.vote(i, node->predict_binned(ctx, i));
+	                        }
+	                    }
+
+	                    nodes[slot + c - first] = std::move(node);
+	                    return;
+	                }
+
+	                if (data.weighted())
+	                {
+	                    std::vector<int> drawn(ROWS_SIZE * N_CLASSES);
+	                    metrics::bootstrap_counts(offsets.data(), drawn.size(), seed, c, drawn.data());
+
+	                    std::vector<int> counts(SAMPLES_SIZE * N_CLASSES, 0);
+	                    std::vector<int> boot;
+	                    for (size_t r = 0; r < ROWS_SIZE; r++)
+	                    {
+	                        const int* drawn_r = drawn.data() + r * N_CLASSES;
+	                        if (std::all_of(drawn_r, drawn_r + N_CLASSES, [] (const int n) { return n == 0; })) continue;
+
+	                        const int row = rows.empty() ? static_cast<int>(r) : rows[r];
+	                        std::copy_n(drawn_r, N_CLASSES, counts.data() + row * N_CLASSES);
+	                        boot.emplace_back(row);
+	                    }
+
+	                    SplitContext weighted = ctx;
+	                    weighted.class_counts = counts.data();
+	                    node->build(weighted, boot, depth, tree_rng);
+
+	                    if (options.prune_alpha >= 0)
+	                    {
+	                        // Copies of a row the draw surely left out (cells are
+	                        // drawn with replacement), reusing the table
+	                        std::vector<int> held;
+	                        for (size_t r = 0; r < ROWS_SIZE; r++)
+	                        {
+	                            const int row = rows.empty() ? static_cast<int>(r) : rows[r];
+	                            const int* all = data.class_counts.data() + row * N_CLASSES;
+	                            int* left_out = counts.data() + row * N_CLASSES;
+
+	                            int n = 0;
+	                            for (size_t k = 0; k < N_CLASSES; k++)
+	                            {
+	                                left_out[k] = std::max(all[k] - left_out[k], 0);
+	                                n += left_out[k];
+	                            }
+
+	                            if (n) held.emplace_back(row);
+	                        }
+
+	                        prune(weighted, held);
+	                    }
+
+	                    nodes[slot + c - first] = std::move(node);
+	                    return;
+	                }
+
+	                // Positions within rows when training on a subset
+	                std::vector<int> boot = metrics::bootstrap(static_cast<int>(ROWS_SIZE), seed, c);
+	                if (!rows.empty())
+	                {
+	                    for (int& idx : boot) idx = rows[idx];
+	                }
+
+	                node->build(ctx, boot, depth, tree_rng);
+
+	                const std::vector<uint64_t> bag = vote || options.prune_alpha >= 0
+	                    ? in_bag(boot, SAMPLES_SIZE)
+	                    : std::vector<uint64_t>();
+
+	                if (options.prune_alpha >= 0)
+	                {
+	                    std::vector<int> held;
+	                    for (size_t r = 0; r < ROWS_SIZE; r++)
+	                    {
+	                        const int row = rows.empty() ? static_cast<int>(r) : rows[r];
+	                        if (!is_in_bag(bag, row)) held.emplace_back(row);
+	                    }
+
+	                    prune(ctx, held);
+	                }
+
+	                if (vote)
+	                {
+	                    for (size_t i = 0; i < SAMPLES_SIZE; i++)
+	                    {
+	                        if (!is_in_bag(bag, i)) oob.vote(i, node->predict_binned(ctx, i));
+	                    }
+	                }
+
+	                nodes[slot + c - first] = std::move(node);
+	            };
+
+	            if (options.growth == TreeOptions::Growth::Oblivious)
+	                train(std::make_shared<ObliviousTree>());
+	            else
+	                train(std::make_shared<DecisionTree>(tree_capacity(sampled ? block.samples_size : ROWS_SIZE, depth.second)));
+	        });
+	    }
+	    group.wait();
+	}
+
 /*	int FastForest::build(
 	    const std::vector<float>& X,
 	    const std::vector<int>& y,
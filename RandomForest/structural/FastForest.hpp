@@ -3,8 +3,14 @@
 
 #include <vector>
 #include <memory>
+#include <span>
 #include "IDecisionNode.hpp"
 #include "DecisionTree.hpp"
+#include "ObliviousTree.hpp"
+#include "TreeOptions.hpp"
+#include "TaskScheduler.hpp"
+#include "BinnedDataset.hpp"
+#include "OutOfBag.hpp"
 #include "../cereal/types/vector.hpp"
 #include "../cereal/types/memory.hpp"
 
@@ -18,10 +24,36 @@ namespace epsilon::ml::rf::structural
 		std::vector<std::shared_ptr<IDecisionNode>> nodes;
 		size_t count;
 
+	public:
+		/**
+		 * Anytime training limits, 0 disables a limit. Trees are added in
+		 * batches until a time budget would be overrun, max_trees is reached,
+		 * or OOB accuracy (TreeOptions::out_of_bag) has not improved by more
+		 * than tolerance for patience batches.
+		 */
+		struct Budget
+		{
+			double wall_seconds = 0.0;
+			double cpu_seconds = 0.0;
+			size_t max_trees = 0;
+			size_t batch = 0;  // 0 -> one tree per scheduler worker
+			size_t patience = 0;
+			double tolerance = 1e-3;
+			size_t min_trees = 16;  // OOB of a few trees is too noisy to judge a plateau
+		};
+
 	public:
 		FastForest() = default;
 		FastForest(size_t c);
 
+		void set_options(const TreeOptions& o);
+
+		/**
+		 * Out-of-bag report of the last build, empty unless
+		 * TreeOptions::out_of_bag was set. Not serialized.
+		 */
+		const OutOfBag& out_of_bag() const { return oob; }
+
 		int predict(const std::vector<float>& data) override;
 		int predict(float* data, size_t size) override;
 
@@ -32,6 +64,91 @@ namespace epsilon::ml::rf::structural
 		    const std::pair<int, int>& depth,
 		    std::mt19937& rng = internal_rng()) override;
 
+		/**
+		 * Trains on a dataset binned once (in memory or from a MappedDataset).
+		 * Trees read the shared matrix through their bootstrap rows, no copy
+		 * of X is made per tree. Always histogram splits. A compacted
+		 * (weighted) dataset gives no out-of-bag report. A set of more than
+		 * TreeOptions::block_rows rows trains each tree on a copy of the rows
+		 * it drew instead.
+		 */
+		int build(
+		    const BinnedDataset& data,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng = internal_rng());
+
+		/**
+		 * Trees [first, last) of the forest of the given seed. Tree c only
+		 * depends on (seed, c), so shards trained on disjoint ranges, in any
+		 * process, merge into the forest a single build would give.
+		 */
+		int build(
+		    const BinnedDataset& data,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed,
+		    const size_t first,
+		    const size_t last);
+
+		/**
+		 * Anytime build: as many trees as the budget allows, at least one
+		 * batch, count is set to the number trained. The forest is valid
+		 * whenever it stops.
+		 */
+		int build(
+		    const BinnedDataset& data,
+		    const std::pair<int, int>& depth,
+		    const Budget& budget,
+		    std::mt19937& rng = internal_rng());
+
+		/**
+		 * count trees bootstrapped from the given rows only (k-fold training).
+		 * No out-of-bag votes.
+		 */
+		int build(
+		    const BinnedDataset& data,
+		    const std::vector<int>& rows,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed);
+
+		/**
+		 * Majority vote for row i of a binned matrix, trees built by this class.
+		 */
+		int predict_binned(const SplitContext& ctx, size_t i) const;
+
+		/**
+		 * fn(tree) on the concrete type of a tree grown by this class.
+		 */
+		template <class F>
+		static decltype(auto) visit(const IDecisionNode& node, F&& fn)
+		{
+			if (const auto* tree = dynamic_cast<const ObliviousTree*>(&node)) return fn(*tree);
+			return fn(static_cast<const DecisionTree&>(node));
+		}
+
+		/**
+		 * Appends the trees of another forest, shards are merged in order.
+		 */
+		void merge(FastForest&& other);
+
+		/**
+		 * DecisionTree::simplify on every tree, for models trained without
+		 * TreeOptions::simplify. Returns the number of nodes removed.
+		 */
+		size_t simplify();
+
+		/**
+		 * Warm start: trains n_trees new trees on data and appends them after
+		 * dropping the drop_oldest first trees. Existing trees are untouched.
+		 * out_of_bag() then reports the appended trees only, not the forest
+		 * they now vote with: the kept trees' bags are not known.
+		 */
+		int extend(
+		    const BinnedDataset& data,
+		    const std::pair<int, int>& depth,
+		    const size_t n_trees,
+		    const size_t drop_oldest = 0,
+		    std::mt19937& rng = internal_rng());
+
 		template <class Archive>
 		void serialize(Archive & ar)
 		{
@@ -39,6 +156,20 @@ namespace epsilon::ml::rf::structural
 		}
 
 		~FastForest() = default;
+
+	private:
+		// Trees [first, last) of the seed into nodes[slot ...], voting out-of-bag
+		void grow_trees(
+		    const BinnedDataset& data,
+		    const std::pair<int, int>& depth,
+		    const uint64_t seed,
+		    const size_t first,
+		    const size_t last,
+		    const size_t slot,
+		    std::span<const int> rows = {});
+
+		TreeOptions options;
+		OutOfBag oob;
 	};
 }
 
@@ -0,0 +1,138 @@
+#include "ForestDAG.hpp"
+#include "FastForest.hpp"
+#include "../algorithm/streams.hpp"
+#include <bit>
+#include <stdexcept>
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	bool NodePool::Key::operator==(const Key& other) const
+	{
+		return std::bit_cast<uint32_t>(node.threshold) == std::bit_cast<uint32_t>(other.node.threshold)
+			&& node.feature == other.node.feature
+			&& node.left == other.node.left
+			&& node.right == other.node.right
+			&& codes == other.codes;
+	}
+
+	size_t NodePool::KeyHash::operator()(const Key& key) const
+	{
+		uint64_t h = streams::mix(std::bit_cast<uint32_t>(key.node.threshold) | (uint64_t(uint32_t(key.node.feature)) << 32));
+		h = streams::mix(h ^ (uint64_t(uint32_t(key.node.left)) | (uint64_t(uint32_t(key.node.right)) << 32)));
+		return static_cast<size_t>(streams::mix(h ^ key.codes));
+	}
+
+	int32_t NodePool::intern(const Node& node, uint64_t codes)
+	{
+		if (index.size() != nodes.size())
+		{
+			index.clear();
+			for (size_t i = 0; i < nodes.size(); i++)
+			{
+				index.emplace(Key{ nodes[i], categories.empty() ? 0 : categories[i] }, static_cast<int32_t>(i));
+			}
+		}
+
+		const auto [it, inserted] = index.emplace(Key{ node, codes }, static_cast<int32_t>(nodes.size()));
+		if (!inserted) return it->second;
+
+		nodes.push_back(node);
+		if (codes && categories.empty()) categories.assign(nodes.size() - 1, 0);
+		if (!categories.empty()) categories.push_back(codes);
+
+		return it->second;
+	}
+
+	std::vector<int32_t> NodePool::intern(const FastForest& forest)
+	{
+		std::vector<int32_t> roots;
+		roots.reserve(forest.nodes.size());
+
+		std::vector<int> order, stack;
+		std::vector<int32_t> ids;
+
+		for (const auto& node : forest.nodes)
+		{
+			const auto* tree = dynamic_cast<const DecisionTree*>(node.get());
+			if (!tree)
+			{
+				throw std::invalid_argument("NodePool: only DecisionTree forests are pooled");
+			}
+
+			// Depth-first order reversed: children are interned before their parent
+			order.clear();
+			stack.assign(1, 0);
+			while (!stack.empty())
+			{
+				const int i = stack.back();
+				stack.pop_back();
+				order.push_back(i);
+
+				const DecisionTree::NodeView view = tree->node(i);
+				if (view.left != -1 || view.right != -1)
+				{
+					stack.push_back(view.right);
+					stack.push_back(view.left);
+				}
+			}
+
+			ids.assign(tree->size(), 0);
+			for (auto i = order.rbegin(); i != order.rend(); ++i)
+			{
+				const DecisionTree::NodeView view = tree->node(*i);
+				ids[*i] = view.left == -1 && view.right == -1
+					? ~view.label
+					: intern({ view.threshold, view.feature, ids[view.left], ids[view.right] }, view.categories);
+			}
+
+			roots.push_back(ids[0]);
+		}
+
+		return roots;
+	}
+
+	ForestDAG::ForestDAG(const FastForest& forest, std::shared_ptr<NodePool> pool)
+		: pool(std::move(pool))
+	{
+		roots = this->pool->intern(forest);
+
+		// Labels only live in the children ids
+		int top = 0;
+		for (const int32_t& root : roots) if (root < 0) top = std::max(top, ~root);
+		for (size_t i = 0; i < this->pool->size(); i++)
+		{
+			const NodePool::Node& node = this->pool->node(static_cast<int32_t>(i));
+			if (node.left < 0) top = std::max(top, ~node.left);
+			if (node.right < 0) top = std::max(top, ~node.right);
+		}
+
+		n_classes = static_cast<size_t>(top) + 1;
+	}
+
+	int ForestDAG::predict(const std::vector<float>& data)
+	{
+		return predict(const_cast<float*>(data.data()), data.size());
+	}
+
+	int ForestDAG::predict(float* data, size_t)
+	{
+		std::vector<int> votes(n_classes, 0);
+		for (const int32_t& root : roots)
+		{
+			++votes[pool->leaf(root, data)];
+		}
+
+		return metrics::majority_label(votes.data(), votes.size());
+	}
+
+	int ForestDAG::build(
+	    const std::vector<float>&,
+	    const std::vector<int>&,
+	    const std::pair<size_t, size_t>&,
+	    const std::pair<int, int>&,
+	    std::mt19937&)
+	{
+	    throw std::logic_error("ForestDAG: build a FastForest, then pool it");
+	}
+}
@@ -0,0 +1,143 @@
+#ifndef __ML_RF_STRUCTURAL_FOREST_DAG__
+#define __ML_RF_STRUCTURAL_FOREST_DAG__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include "../cereal/types/vector.hpp"
+#include "../cereal/types/memory.hpp"
+#include "IDecisionNode.hpp"
+#include "DecisionTree.hpp"
+#include "../algorithm/metrics.hpp"
+
+namespace metrics = epsilon::ml::rf::algorithm::metrics;
+
+namespace epsilon::ml::rf::structural
+{
+	class FastForest;
+
+	/**
+	 * Hash-consed split nodes: a subtree is stored once however many trees,
+	 * or models, contain it. A child id >= 0 is a node of the pool, a
+	 * negative one the leaf ~label, so leaves take no storage.
+	 *
+	 * Interning is not thread-safe, lookups are.
+	 */
+	class NodePool
+	{
+	public:
+		struct Node
+		{
+			float threshold;
+			int32_t feature;
+			int32_t left;
+			int32_t right;
+
+			template <class Archive>
+			void serialize(Archive & ar)
+			{
+				ar(threshold, feature, left, right);
+			}
+		};
+
+		/**
+		 * Id of the node, added unless an equal one (same test, same
+		 * children ids) is already pooled.
+		 */
+		int32_t intern(const Node& node, uint64_t codes = 0);
+
+		/**
+		 * Every tree of the forest, roots in order. DecisionTree only.
+		 */
+		std::vector<int32_t> intern(const FastForest& forest);
+
+		bool goes_left(int32_t id, float value) const
+		{
+			const uint64_t codes = categories.empty() ? 0 : categories[id];
+			return codes ? metrics::in_categories(codes, value) : value < nodes[id].threshold;
+		}
+
+		int leaf(int32_t id, const float* x) const
+		{
+			while (id >= 0)
+			{
+				const Node& node = nodes[id];
+				id = goes_left(id, x[node.feature]) ? node.left : node.right;
+			}
+
+			return ~id;
+		}
+
+		const Node& node(int32_t id) const { return nodes[id]; }
+		size_t size() const { return nodes.size(); }
+		size_t bytes() const { return nodes.size() * sizeof(Node) + categories.size() * sizeof(uint64_t); }
+
+		template <class Archive>
+		void serialize(Archive & ar)
+		{
+			ar(nodes, categories);
+		}
+
+	private:
+		struct Key
+		{
+			Node node;
+			uint64_t codes;
+
+			// Thresholds by bits, as hashed
+			bool operator==(const Key& other) const;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<uint64_t> categories;  // per node, empty without categorical splits
+
+		// Not serialized, rebuilt on the first intern after loading
+		std::unordered_map<Key, int32_t, KeyHash> index;
+	};
+
+	/**
+	 * A forest whose trees are roots in a NodePool, voting like FastForest.
+	 * Several models built on one pool share every common subtree.
+	 */
+	class ForestDAG final : public IDecisionNode
+	{
+	public:
+		ForestDAG() = default;
+		ForestDAG(const FastForest& forest, std::shared_ptr<NodePool> pool = std::make_shared<NodePool>());
+
+		int predict(const std::vector<float>& data) override;
+		int predict(float* data, size_t size) override;
+
+		/**
+		 * Not supported, a DAG is made from a trained forest.
+		 */
+		int build(
+		    const std::vector<float>& X,
+		    const std::vector<int>& y,
+		    const std::pair<size_t, size_t>& size,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng = internal_rng()) override;
+
+		size_t trees() const { return roots.size(); }
+		const NodePool& node_pool() const { return *pool; }
+
+		template <class Archive>
+		void serialize(Archive & ar, const std::uint32_t)
+		{
+			ar(pool, roots, n_classes);
+		}
+
+	private:
+		std::shared_ptr<NodePool> pool;
+		std::vector<int32_t> roots;
+		size_t n_classes = 0;
+	};
+}
+
+#endif
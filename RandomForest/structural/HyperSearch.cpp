@@ -0,0 +1,179 @@
+#include "HyperSearch.hpp"
+#include "FastForest.hpp"
+#include "TaskScheduler.hpp"
+#include "../algorithm/streams.hpp"
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+namespace epsilon::ml::rf::structural
+{
+	HyperSearch::HyperSearch(const BinnedDataset& data, const TreeOptions& base, size_t folds)
+		: data(data), base(base), folds(folds)
+	{
+		if (data.weighted() && folds == 0)
+		{
+			throw std::invalid_argument("HyperSearch: a compacted dataset has no out-of-bag score, use folds");
+		}
+
+		if (folds > 0 && data.samples_size > static_cast<size_t>(std::numeric_limits<int>::max()))
+		{
+			throw std::invalid_argument("HyperSearch: folds index rows with int, score out-of-bag");
+		}
+	}
+
+	std::vector<HyperSearch::Candidate> HyperSearch::grid(
+		const std::vector<size_t>& n_trees,
+		const std::vector<int>& max_depths,
+		const std::vector<float>& max_features,
+		const std::vector<size_t>& min_samples_leaf)
+	{
+		std::vector<Candidate> candidates;
+		for (const size_t& t : n_trees)
+			for (const int& d : max_depths)
+				for (const float& f : max_features)
+					for (const size_t& l : min_samples_leaf)
+						candidates.push_back({ t, d, f, l });
+
+		return candidates;
+	}
+
+	TreeOptions HyperSearch::options_for(const Candidate& candidate) const
+	{
+		TreeOptions options = base;
+		options.max_features = candidate.max_features;
+		options.min_samples_leaf = candidate.min_samples_leaf;
+		options.out_of_bag = folds == 0;
+		return options;
+	}
+
+	std::vector<HyperSearch::Result> HyperSearch::run(const std::vector<Candidate>& candidates, uint64_t seed) const
+	{
+		const size_t SAMPLES_SIZE = data.samples_size;
+		const size_t FEATURES_SIZE = data.features_size;
+		const SplitContext ctx = data.context();
+
+		// Same folds for every candidate: a seeded shuffle dealt round-robin
+		std::vector<std::vector<int>> train_rows(folds), test_rows(folds);
+		if (folds > 0)
+		{
+			std::vector<int> order(SAMPLES_SIZE);
+			std::iota(order.begin(), order.end(), 0);
+			streams::Stream rng(seed, 0x666f6c64);
+			std::shuffle(order.begin(), order.end(), rng);
+
+			for (size_t k = 0; k < SAMPLES_SIZE; k++)
+			{
+				for (size_t fold = 0; fold < folds; fold++)
+				{
+					(k % folds == fold ? test_rows : train_rows)[fold].push_back(order[k]);
+				}
+			}
+		}
+
+		std::vector<Result> results(candidates.size());
+		std::vector<std::unique_ptr<FastForest>> forests(candidates.size());
+
+		TaskScheduler::TaskGroup group;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			group.run([&, i] {
+				const Candidate& candidate = candidates[i];
+				const std::pair<int, int> depth = { 0, candidate.max_depth };
+				std::unique_ptr<FastForest> forest;
+
+				if (folds == 0)
+				{
+					forest = std::make_unique<FastForest>(candidate.n_trees);
+					forest->set_options(options_for(candidate));
+					forest->build(data, depth, seed, 0, candidate.n_trees);
+					results[i].accuracy = forest->out_of_bag().accuracy;
+				}
+				else
+				{
+					size_t correct = 0, total = 0;
+					for (size_t fold = 0; fold < folds; fold++)
+					{
+						forest = std::make_unique<FastForest>(candidate.n_trees);
+						forest->set_options(options_for(candidate));
+						forest->build(data, train_rows[fold], depth, seed);
+
+						// A weighted row scores every row it stands for
+						for (const int& row : test_rows[fold])
+						{
+							const int predicted = forest->predict_binned(ctx, row);
+							if (data.weighted())
+							{
+								const int* counts = data.class_counts.data() + row * data.n_classes;
+								correct += counts[predicted];
+								total += std::accumulate(counts, counts + data.n_classes, size_t(0));
+							}
+							else
+							{
+								correct += predicted == data.y[row];
+								++total;
+							}
+						}
+					}
+					results[i].accuracy = total ? static_cast<double>(correct) / total : 0.0;
+				}
+
+				results[i].candidate = candidate;
+				for (const auto& node : forest->nodes)
+				{
+					results[i].nodes += FastForest::visit(*node, [] (const auto& tree) { return tree.size(); });
+				}
+
+				forests[i] = std::move(forest);
+			});
+		}
+		group.wait();
+
+		// Latency is timed after training, one forest at a time, on rows rebuilt
+		// from their bins' lower edges
+		const size_t PROBES = std::min<size_t>(SAMPLES_SIZE, 1000);
+		std::vector<float> probes(PROBES * FEATURES_SIZE);
+		for (size_t i = 0; i < PROBES; i++)
+		{
+			for (size_t f = 0; f < FEATURES_SIZE; f++)
+			{
+				probes[i * FEATURES_SIZE + f] = ctx.edges(f)[ctx.feature(f)[i]];
+			}
+		}
+
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			volatile int sink = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t p = 0; p < PROBES; p++)
+			{
+				sink = sink + forests[i]->predict(probes.data() + p * FEATURES_SIZE, FEATURES_SIZE);
+			}
+			const double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+			results[i].latency_us = PROBES ? elapsed / PROBES : 0.0;
+			forests[i].reset();
+		}
+
+		// Accuracy-latency frontier
+		std::vector<size_t> by_latency(results.size());
+		std::iota(by_latency.begin(), by_latency.end(), 0);
+		std::stable_sort(by_latency.begin(), by_latency.end(), [&] (size_t a, size_t b) {
+			return results[a].latency_us < results[b].latency_us;
+		});
+
+		double best = -1.0;
+		for (const size_t& i : by_latency)
+		{
+			if (results[i].accuracy > best)
+			{
+				results[i].frontier = true;
+				best = results[i].accuracy;
+			}
+		}
+
+		return results;
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef __ML_RF_STRUCTURAL_HYPER_SEARCH__
+#define __ML_RF_STRUCTURAL_HYPER_SEARCH__
+
+#include <vector>
+#include <cstdint>
+#include "BinnedDataset.hpp"
+#include "TreeOptions.hpp"
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Hyperparameter search on one binned dataset.
+	 *
+	 * Every candidate forest reads the same read-only matrix and uses the
+	 * same seed, hence the same bootstrap of tree c (common random numbers,
+	 * differences come from the parameters). Candidates train concurrently
+	 * as scheduler tasks, their trees as nested tasks.
+	 */
+	class HyperSearch
+	{
+	public:
+		struct Candidate
+		{
+			size_t n_trees = 100;
+			int max_depth = 16;
+			float max_features = 0.0f;  // 0 -> sqrt(features)
+			size_t min_samples_leaf = 1;
+		};
+
+		struct Result
+		{
+			Candidate candidate;
+			double accuracy = 0.0;
+			double latency_us = 0.0;  // single-row predict, one thread
+			size_t nodes = 0;
+			bool frontier = false;    // no faster candidate is as accurate
+		};
+
+		/**
+		 * folds == 0 scores by out-of-bag accuracy, otherwise k-fold.
+		 * A compacted dataset needs folds, duplicates then share a fold.
+		 */
+		HyperSearch(const BinnedDataset& data, const TreeOptions& base = {}, size_t folds = 0);
+
+		static std::vector<Candidate> grid(
+			const std::vector<size_t>& n_trees,
+			const std::vector<int>& max_depths,
+			const std::vector<float>& max_features,
+			const std::vector<size_t>& min_samples_leaf);
+
+		std::vector<Result> run(const std::vector<Candidate>& candidates, uint64_t seed) const;
+
+	private:
+		TreeOptions options_for(const Candidate& candidate) const;
+
+		const BinnedDataset& data;
+		TreeOptions base;
+		size_t folds;
+	};
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "MappedDataset.hpp"
+#include "../algorithm/sketch.hpp"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace epsilon::ml::rf::structural
+{
+	namespace
+	{
+		constexpr char MAGIC[8] = { 'R', 'F', 'C', 'O', 'L', 'S', '1', '\0' };
+
+		struct Header
+		{
+			char magic[8];
+			uint64_t features;
+			uint64_t samples;
+		};
+	}
+
+	MappedDataset::MappedDataset(const std::string& path)
+	{
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::runtime_error("MappedDataset: cannot open " + path);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+		{
+			::close(fd);
+			throw std::runtime_error("MappedDataset: invalid file " + path);
+		}
+
+		length = static_cast<size_t>(st.st_size);
+		base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (base == MAP_FAILED)
+		{
+			::close(fd);
+			throw std::runtime_error("MappedDataset: cannot map " + path);
+		}
+
+		Header header;
+		std::memcpy(&header, base, sizeof(Header));
+		features = header.features;
+		samples = header.samples;
+
+		const size_t expected = sizeof(Header)
+			+ features * samples * sizeof(float)
+			+ samples * sizeof(int32_t);
+
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || length < expected)
+		{
+			::munmap(base, length);
+			::close(fd);
+			throw std::runtime_error("MappedDataset: bad header in " + path);
+		}
+
+		::madvise(base, length, MADV_SEQUENTIAL);
+	}
+
+	MappedDataset::~MappedDataset()
+	{
+		if (base && base != MAP_FAILED) ::munmap(base, length);
+		if (fd >= 0) ::close(fd);
+	}
+
+	void MappedDataset::write(
+		const std::string& path,
+		const std::vector<float>& X,
+		const std::vector<int>& y,
+		const std::pair<size_t, size_t>& size)
+	{
+		std::ofstream os(path, std::ios::binary);
+		if (!os)
+		{
+			throw std::runtime_error("MappedDataset: cannot write " + path);
+		}
+
+		Header header;
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.features = size.first;
+		header.samples = size.second;
+
+		std::vector<int32_t> labels(y.begin(), y.end());
+
+		os.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		os.write(reinterpret_cast<const char*>(X.data()), X.size() * sizeof(float));
+		os.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(int32_t));
+	}
+
+	const float* MappedDataset::column(size_t f) const
+	{
+		const char* data = static_cast<const char*>(base) + sizeof(Header);
+		return reinterpret_cast<const float*>(data) + f * samples;
+	}
+
+	const int* MappedDataset::labels() const
+	{
+		return reinterpret_cast<const int*>(column(features));
+	}
+
+	void MappedDataset::release(const void* data, size_t bytes) const
+	{
+		// Whole pages only, a page shared with the next chunk is paged in again if needed
+		const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		const uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+		const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(page - 1);
+
+		if (end > begin)
+		{
+			::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+		}
+	}
+
+	BinnedDataset MappedDataset::bin(size_t chunk_size) const
+	{
+		BinnedDataset data;
+		data.features_size = features;
+		data.samples_size = samples;
+		data.X_binned.resize(features * samples);
+		data.bin_edges.resize((metrics::MAX_BINS + 1) * features);
+		data.exact_bins.assign(features, 0);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (size_t feat = 0; feat < features; ++feat)
+		{
+			const float* Xf = column(feat);
+			uint8_t* Xf_binned = data.X_binned.data() + feat * samples;
+			float* edges = data.bin_edges.data() + feat * (metrics::MAX_BINS + 1);
+
+			algorithm::sketch::QuantileSketch sketch(4096, metrics::MAX_BINS);
+			for (size_t begin = 0; begin < samples; begin += chunk_size)
+			{
+				const size_t n = std::min(chunk_size, samples - begin);
+				sketch.update(Xf + begin, n);
+				release(Xf + begin, n * sizeof(float));
+			}
+
+			const size_t n_bins = metrics::quantile_edges(sketch, edges);
+			data.exact_bins[feat] = sketch.exact();
+
+			for (size_t begin = 0; begin < samples; begin += chunk_size)
+			{
+				const size_t n = std::min(chunk_size, samples - begin);
+				metrics::assign_bins(edges, n_bins, Xf + begin, Xf_binned + begin, n);
+				release(Xf + begin, n * sizeof(float));
+			}
+		}
+
+		const int* y = labels();
+		data.y.assign(y, y + samples);
+		data.n_classes = samples ? static_cast<size_t>(*std::max_element(y, y + samples) + 1) : 0;
+		release(y, samples * sizeof(int32_t));
+
+		return data;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef __ML_RF_STRUCTURAL_MAPPED_DATASET__
+#define __ML_RF_STRUCTURAL_MAPPED_DATASET__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "BinnedDataset.hpp"
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Read-only memory mapping of a feature-major dataset file:
+	 *
+	 *   header  : "RFCOLS1\0", uint64 features, uint64 samples
+	 *   columns : features x samples float32, one column per feature
+	 *   labels  : samples int32
+	 *
+	 * Columns are paged in on demand and dropped once consumed, so a
+	 * dataset larger than memory can be binned in one sequential pass.
+	 */
+	class MappedDataset
+	{
+	public:
+		explicit MappedDataset(const std::string& path);
+		MappedDataset(const MappedDataset&) = delete;
+		MappedDataset& operator=(const MappedDataset&) = delete;
+		~MappedDataset();
+
+		static void write(
+			const std::string& path,
+			const std::vector<float>& X,
+			const std::vector<int>& y,
+			const std::pair<size_t, size_t>& size);
+
+		size_t features_size() const { return features; }
+		size_t samples_size() const { return samples; }
+
+		const float* column(size_t f) const;
+		const int* labels() const;
+
+		/**
+		 * Bins every column in chunks of chunk_size values: a sketch pass
+		 * for the edges, then a pass to assign bins. Pages of a chunk are
+		 * released right after use, only the binned matrix stays resident.
+		 */
+		BinnedDataset bin(size_t chunk_size = size_t(1) << 20) const;
+
+	private:
+		void release(const void* data, size_t bytes) const;
+
+		int fd = -1;
+		void* base = nullptr;
+		size_t length = 0;
+		size_t features = 0;
+		size_t samples = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,379 @@
+#include "ObliviousTree.hpp"
+#include "ScratchArena.hpp"
+#include "TaskScheduler.hpp"
+#include "../algorithm/streams.hpp"
+#include <numeric>
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	namespace
+	{
+		struct LevelSplit
+		{
+			double gain = 0.0;
+			int feature = -1;
+			int bin = 0;
+		};
+
+		/**
+		 * Best threshold of one feature for a whole level. Rows are visited
+		 * by bin (counting sort) and moved from the right to the left side
+		 * of their leaf, only the leaves touched by a bin are rescored.
+		 * leaf_counts holds n_leaves x n_classes counts, total their sum.
+		 * A threshold leaving any non-empty leaf with a side under min_leaf
+		 * samples is not scored.
+		 */
+		template <metrics::ImpurityCriterion Criterion>
+		LevelSplit sweep_level(
+		    const SplitContext& ctx,
+		    const std::vector<int>& rows,
+		    const uint32_t* leaf_of,
+		    const int* leaf_counts,
+		    const size_t n_leaves,
+		    const int64_t total,
+		    const int64_t min_leaf,
+		    const int feature,
+		    ScratchArena& arena)
+		{
+		    ArenaScope scope(arena);
+		    LevelSplit best;
+
+		    const size_t K = ctx.n_classes;
+		    const size_t n_rows = rows.size();
+		    const uint8_t* Xf = ctx.feature(feature);
+
+		    scratch_vector<uint32_t> offsets(metrics::MAX_BINS + 1, 0, &arena);
+		    for (size_t r = 0; r < n_rows; r++)
+		    {
+		        ++offsets[Xf[rows[r]] + 1];
+		    }
+		    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		    scratch_vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1, &arena);
+		    scratch_vector<uint32_t> order(n_rows, &arena);
+		    for (size_t r = 0; r < n_rows; r++)
+		    {
+		        order[cursor[Xf[rows[r]]]++] = static_cast<uint32_t>(r);
+		    }
+
+		    scratch_vector<int> left(n_leaves * K, 0, &arena);
+		    scratch_vector<int> right(leaf_counts, leaf_counts + n_leaves * K, &arena);
+		    scratch_vector<double> l_sum(n_leaves, 0.0, &arena), r_sum(n_leaves, 0.0, &arena);
+		    scratch_vector<int64_t> l_n(n_leaves, 0, &arena), r_n(n_leaves, 0, &arena);
+		    scratch_vector<double> contrib(n_leaves, 0.0, &arena);
+
+		    // Leaves with a non-empty side under min_leaf; a one-sided leaf is fine
+		    scratch_vector<uint8_t> small(n_leaves, 0, &arena);
+		    size_t n_small = 0;
+
+		    double parent = 0.0;
+		    for (size_t leaf = 0; leaf < n_leaves; leaf++)
+		    {
+		        for (size_t k = 0; k < K; k++)
+		        {
+		            r_sum[leaf] += Criterion::term(right[leaf * K + k]);
+		            r_n[leaf] += right[leaf * K + k];
+		        }
+
+		        contrib[leaf] = r_n[leaf] * Criterion::impurity(r_n[leaf], r_sum[leaf]);
+		        parent += contrib[leaf];
+
+		        small[leaf] = r_n[leaf] > 0 && r_n[leaf] < min_leaf;
+		        n_small += small[leaf];
+		    }
+
+		    const auto move = [&] (const uint32_t leaf, const size_t k, const int w) {
+		        int& l = left[leaf * K + k];
+		        int& r = right[leaf * K + k];
+		        l_sum[leaf] += Criterion::term(l + w) - Criterion::term(l);
+		        r_sum[leaf] += Criterion::term(r - w) - Criterion::term(r);
+		        l += w;
+		        r -= w;
+		        l_n[leaf] += w;
+		        r_n[leaf] -= w;
+		    };
+
+		    scratch_vector<uint32_t> touched(&arena);
+		    scratch_vector<uint8_t> seen(n_leaves, 0, &arena);
+
+		    double children = parent;
+		    int64_t moved = 0;
+
+		    for (size_t bin = 0; bin + 1 < metrics::MAX_BINS; bin++)
+		    {
+		        if (offsets[bin] == offsets[bin + 1]) continue;
+
+		        for (uint32_t p = offsets[bin]; p < offsets[bin + 1]; p++)
+		        {
+		            const uint32_t r = order[p];
+		            const uint32_t leaf = leaf_of[r];
+		            const int idx = rows[r];
+
+		            if (ctx.class_counts)
+		            {
+		                const int* row = ctx.class_counts + idx * K;
+		                for (size_t k = 0; k < K; k++)
+		                {
+		                    if (row[k]) move(leaf, k, row[k]);
+		                    moved += row[k];
+		                }
+		            }
+		            else
+		            {
+		                move(leaf, ctx.y[idx], 1);
+		                ++moved;
+		            }
+
+		            if (!seen[leaf])
+		            {
+		                seen[leaf] = 1;
+		                touched.emplace_back(leaf);
+		            }
+		        }
+
+		        for (const uint32_t& leaf : touched)
+		        {
+		            const double score = l_n[leaf] * Criterion::impurity(l_n[leaf], l_sum[leaf])
+		                + r_n[leaf] * Criterion::impurity(r_n[leaf], r_sum[leaf]);
+		            children += score - contrib[leaf];
+		            contrib[leaf] = score;
+		            seen[leaf] = 0;
+
+		            const uint8_t is_small = (l_n[leaf] > 0 && l_n[leaf] < min_leaf)
+		                || (r_n[leaf] > 0 && r_n[leaf] < min_leaf);
+		            n_small += is_small;
+		            n_small -= small[leaf];
+		            small[leaf] = is_small;
+		        }
+		        touched.clear();
+
+		        if (moved >= total) break;
+
+		        if (n_small == 0 && parent - children > best.gain)
+		        {
+		            best.gain = parent - children;
+		            best.feature = feature;
+		            best.bin = static_cast<int>(bin + 1);
+		        }
+		    }
+
+		    return best;
+		}
+	}
+
+	void ObliviousTree::set_options(const TreeOptions& o)
+	{
+		options = o;
+	}
+
+	int ObliviousTree::predict(const std::vector<float>& data)
+	{
+		return predict_column(data.data(), 1, 0);
+	}
+
+	int ObliviousTree::predict(float* data, size_t)
+	{
+		return predict_column(data, 1, 0);
+	}
+
+	int ObliviousTree::predict_column(const float* X, size_t stride, size_t i) const
+	{
+		size_t leaf = 0;
+		for (size_t d = 0; d < features.size(); d++)
+		{
+			leaf = (leaf << 1) | !(X[features[d] * stride + i] < thresholds[d]);
+		}
+
+		return labels[leaf];
+	}
+
+	int ObliviousTree::predict_binned(const SplitContext& ctx, size_t i) const
+	{
+		size_t leaf = 0;
+		for (size_t d = 0; d < features.size(); d++)
+		{
+			const int f = features[d];
+			leaf = (leaf << 1) | !(ctx.edges(f)[ctx.feature(f)[i]] < thresholds[d]);
+		}
+
+		return labels[leaf];
+	}
+
+	void ObliviousTree::predict_batch(const float* X, size_t stride, size_t n, int* out) const
+	{
+		std::fill(out, out + n, 0);
+
+		for (size_t d = 0; d < features.size(); d++)
+		{
+			const float* Xf = X + features[d] * stride;
+			const float threshold = thresholds[d];
+
+			#pragma omp simd
+			for (size_t i = 0; i < n; i++)
+			{
+				out[i] = (out[i] << 1) | !(Xf[i] < threshold);
+			}
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = labels[out[i]];
+		}
+	}
+
+	int ObliviousTree::build(
+	    const std::vector<float>& X,
+	    const std::vector<int>& y,
+	    const std::pair<size_t, size_t>& size,
+	    const std::pair<int, int>& depth,
+	    std::mt19937& rng)
+	{
+	    std::vector<float> bin_edges;
+	    std::vector<uint8_t> X_binned;
+	    metrics::discretize_t(X_binned, bin_edges, X, size);
+
+	    const SplitContext ctx = {
+	        .X_binned = X_binned.data(),
+	        .bin_edges = bin_edges.data(),
+	        .y = y.data(),
+	        .samples_size = size.second,
+	        .features_size = size.first,
+	        .n_classes = static_cast<size_t>(*std::max_element(y.begin(), y.end()) + 1)
+	    };
+
+	    std::vector<int> rows(size.second);
+	    std::iota(rows.begin(), rows.end(), 0);
+
+	    return build(ctx, rows, depth, rng);
+	}
+
+	int ObliviousTree::build(
+	    const SplitContext& ctx,
+	    const std::vector<int>& rows,
+	    const std::pair<int, int>& depth,
+	    std::mt19937& rng)
+	{
+	    const uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+	    const int max_levels = std::clamp(depth.second - depth.first, 0, MAX_LEVELS);
+
+	    switch (options.criterion)
+	    {
+	    case TreeOptions::Criterion::Entropy:
+	        grow<metrics::Entropy>(ctx, rows, max_levels, seed);
+	        break;
+	    default:
+	        grow<metrics::Gini>(ctx, rows, max_levels, seed);
+	        break;
+	    }
+
+	    return size() - 1;
+	}
+
+	template <metrics::ImpurityCriterion Criterion>
+	void ObliviousTree::grow(
+	    const SplitContext& ctx,
+	    const std::vector<int>& rows,
+	    const int max_levels,
+	    const uint64_t seed)
+	{
+	    ScratchArena& arena = ScratchArena::local();
+	    ArenaScope tree_scope(arena);
+
+	    const size_t K = ctx.n_classes;
+	    const size_t n_rows = rows.size();
+	    const size_t m = options.max_features > 0
+	        ? std::clamp<size_t>(static_cast<size_t>(std::lround(options.max_features * ctx.features_size)), 1, ctx.features_size)
+	        : static_cast<size_t>(std::sqrt(ctx.features_size));
+
+	    features.clear();
+	    thresholds.clear();
+
+	    scratch_vector<uint32_t> leaf_of(n_rows, 0, &arena);
+	    scratch_vector<int> leaf_counts(K, 0, &arena);
+	    for (const int& idx : rows)
+	    {
+	        if (ctx.class_counts)
+	        {
+	            for (size_t k = 0; k < K; k++) leaf_counts[k] += ctx.class_counts[idx * K + k];
+	        }
+	        else
+	        {
+	            ++leaf_counts[ctx.y[idx]];
+	        }
+	    }
+
+	    const int64_t total = std::accumulate(leaf_counts.begin(), leaf_counts.end(), int64_t(0));
+	    scratch_vector<int> leaf_labels(1, metrics::majority_label(leaf_counts.data(), K), &arena);
+
+	    const int64_t min_leaf = static_cast<int64_t>(std::max<size_t>(options.min_samples_leaf, 1));
+
+	    // The running sums drift by a few ulps, below this a level is no split
+	    const double min_gain = std::max<double>(options.min_impurity_decrease, 1e-7) * total;
+
+	    scratch_vector<int> selected(ctx.features_size, &arena);
+	    scratch_vector<LevelSplit> candidates(&arena);
+
+	    for (int d = 0; d < max_levels; d++)
+	    {
+	        const size_t n_leaves = size_t(1) << d;
+
+	        streams::Stream rng(seed, static_cast<uint64_t>(d) + 1);
+	        std::iota(selected.begin(), selected.end(), 0);
+	        streams::partial_shuffle(selected.data(), ctx.features_size, m, rng);
+
+	        candidates.assign(m, LevelSplit{});
+	        TaskScheduler::instance().parallel_for(0, m, 1, [&] (const size_t begin, const size_t end) {
+	            for (size_t f = begin; f < end; f++)
+	            {
+	                candidates[f] = sweep_level<Criterion>(ctx, rows, leaf_of.data(), leaf_counts.data(),
+	                    n_leaves, total, min_leaf, selected[f], ScratchArena::local());
+	            }
+	        });
+
+	        LevelSplit best;
+	        for (const LevelSplit& candidate : candidates)
+	        {
+	            if (candidate.gain > best.gain) best = candidate;
+	        }
+
+	        if (best.feature < 0 || best.gain <= min_gain) break;
+
+	        features.emplace_back(best.feature);
+	        thresholds.emplace_back(ctx.edges(best.feature)[best.bin]);
+
+	        // Every leaf splits in two, the right child takes the low bit
+	        const uint8_t* Xs = ctx.feature(best.feature);
+	        scratch_vector<int> next_counts(2 * n_leaves * K, 0, &arena);
+	        for (size_t r = 0; r < n_rows; r++)
+	        {
+	            const int idx = rows[r];
+	            leaf_of[r] = (leaf_of[r] << 1) | (Xs[idx] >= best.bin);
+
+	            int* counts = next_counts.data() + leaf_of[r] * K;
+	            if (ctx.class_counts)
+	            {
+	                for (size_t k = 0; k < K; k++) counts[k] += ctx.class_counts[idx * K + k];
+	            }
+	            else
+	            {
+	                ++counts[ctx.y[idx]];
+	            }
+	        }
+
+	        // An empty leaf answers like its parent
+	        scratch_vector<int> next_labels(2 * n_leaves, &arena);
+	        for (size_t leaf = 0; leaf < 2 * n_leaves; leaf++)
+	        {
+	            const int* counts = next_counts.data() + leaf * K;
+	            const bool empty = std::all_of(counts, counts + K, [] (const int c) { return c == 0; });
+	            next_labels[leaf] = empty ? leaf_labels[leaf >> 1] : metrics::majority_label(counts, K);
+	        }
+
+	        leaf_counts = std::move(next_counts);
+	        leaf_labels = std::move(next_labels);
+	    }
+
+	    labels.assign(leaf_labels.begin(), leaf_labels.end());
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef __ML_RF_STRUCTURAL_OBLIVIOUS_TREE__
+#define __ML_RF_STRUCTURAL_OBLIVIOUS_TREE__
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include "../cereal/types/vector.hpp"
+#include "TreeOptions.hpp"
+#include "SplitSearch.hpp"
+#include "IDecisionNode.hpp"
+#include "../algorithm/metrics.hpp"
+
+namespace metrics = epsilon::ml::rf::algorithm::metrics;
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Oblivious (symmetric) tree: every node of level d tests the same
+	 * feature against the same threshold, so a sample's leaf is the D bits
+	 * !(x[features[d]] < thresholds[d]), first level most significant.
+	 * No node array to walk, evaluation is D compares and one lookup.
+	 *
+	 * Levels are chosen greedily on the bins, each one the split that
+	 * lowers the impurity summed over every current leaf the most.
+	 * Categorical features are split as ordered codes.
+	 */
+	class ObliviousTree final : public IDecisionNode
+	{
+	public:
+		static constexpr int MAX_LEVELS = 16;
+
+		ObliviousTree() = default;
+
+		void set_options(const TreeOptions& o);
+
+		int predict(const std::vector<float>& data) override;
+		int predict(float* data, size_t size) override;
+
+		int predict_column(const float* X, size_t stride, size_t i) const;
+		int predict_binned(const SplitContext& ctx, size_t i) const;
+
+		/**
+		 * Labels of samples [0, n) of a feature-major matrix, stride values
+		 * per feature: one pass per level over every sample, branch-free.
+		 */
+		void predict_batch(const float* X, size_t stride, size_t n, int* out) const;
+
+		int build(
+		    const std::vector<float>& X,
+		    const std::vector<int>& y,
+		    const std::pair<size_t, size_t>& size,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng = internal_rng()) override;
+
+		/**
+		 * Same contract as DecisionTree::build on a binned dataset,
+		 * depth.second - depth.first levels at most (MAX_LEVELS).
+		 */
+		int build(
+		    const SplitContext& ctx,
+		    const std::vector<int>& rows,
+		    const std::pair<int, int>& depth,
+		    std::mt19937& rng);
+
+		int levels() const { return static_cast<int>(features.size()); }
+		int size() const { return static_cast<int>(features.size() + labels.size()); }
+
+		template <class Archive>
+		void serialize(Archive & ar, const std::uint32_t)
+		{
+			ar(features, thresholds, labels);
+		}
+
+	private:
+		template <metrics::ImpurityCriterion Criterion>
+		void grow(
+		    const SplitContext& ctx,
+		    const std::vector<int>& rows,
+		    const int max_levels,
+		    const uint64_t seed);
+
+		std::vector<int> features;
+		std::vector<float> thresholds;
+		std::vector<int> labels;  // 2^levels leaves
+		TreeOptions options;
+	};
+}
+
+#endif
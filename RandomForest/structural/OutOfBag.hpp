@@ -0,0 +1,85 @@
+#ifndef __ML_RF_STRUCTURAL_OUT_OF_BAG__
+#define __ML_RF_STRUCTURAL_OUT_OF_BAG__
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Rows drawn by a bootstrap, one bit per sample.
+	 */
+	inline std::vector<uint64_t> in_bag(const std::vector<int>& boot, size_t samples_size)
+	{
+		std::vector<uint64_t> bits((samples_size + 63) / 64, 0);
+		for (const int& idx : boot)
+		{
+			bits[idx >> 6] |= uint64_t(1) << (idx & 63);
+		}
+
+		return bits;
+	}
+
+	inline bool is_in_bag(const std::vector<uint64_t>& bits, size_t i)
+	{
+		return (bits[i >> 6] >> (i & 63)) & 1;
+	}
+
+	/**
+	 * Out-of-bag votes gathered while the forest trains: every tree votes
+	 * for the rows its bootstrap left out. Rows no tree left out are not
+	 * evaluated.
+	 */
+	struct OutOfBag
+	{
+		size_t samples_size = 0;
+		size_t n_classes = 0;
+		std::vector<int> votes;      // samples x classes
+		std::vector<int> confusion;  // actual x predicted
+		size_t evaluated = 0;
+		size_t correct = 0;
+		double accuracy = 0.0;
+
+		bool empty() const { return votes.empty(); }
+
+		void reset(size_t samples, size_t classes)
+		{
+			samples_size = samples;
+			n_classes = classes;
+			votes.assign(samples * classes, 0);
+			confusion.assign(classes * classes, 0);
+			evaluated = correct = 0;
+			accuracy = 0.0;
+		}
+
+		// Trees vote concurrently
+		void vote(size_t i, int label)
+		{
+			std::atomic_ref<int>(votes[i * n_classes + label]).fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void finalize(const int* y)
+		{
+			std::fill(confusion.begin(), confusion.end(), 0);
+			evaluated = correct = 0;
+
+			for (size_t i = 0; i < samples_size; i++)
+			{
+				const int* v = votes.data() + i * n_classes;
+				const int* best = std::max_element(v, v + n_classes);
+				if (*best == 0) continue;
+
+				const int predicted = static_cast<int>(best - v);
+				++confusion[y[i] * n_classes + predicted];
+				++evaluated;
+				correct += predicted == y[i];
+			}
+
+			accuracy = evaluated ? static_cast<double>(correct) / evaluated : 0.0;
+		}
+	};
+}
+
+#endif
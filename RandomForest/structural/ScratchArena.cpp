@@ -0,0 +1,87 @@
+#include "ScratchArena.hpp"
+#include <algorithm>
+
+namespace epsilon::ml::rf::structural
+{
+	ScratchArena::ScratchArena(size_t block_size) : block_size(block_size)
+	{
+	}
+
+	ScratchArena& ScratchArena::local()
+	{
+		thread_local ScratchArena arena;
+		return arena;
+	}
+
+	ScratchArena::Marker ScratchArena::mark() const
+	{
+		return { current, offset };
+	}
+
+	void ScratchArena::rewind(const Marker& marker)
+	{
+		current = marker.block;
+		offset = marker.offset;
+	}
+
+	void ScratchArena::reset()
+	{
+		current = 0;
+		offset = 0;
+	}
+
+	size_t ScratchArena::capacity() const
+	{
+		size_t total = 0;
+		for (const auto& block : blocks)
+		{
+			total += block.size;
+		}
+
+		return total;
+	}
+
+	void* ScratchArena::do_allocate(size_t bytes, size_t alignment)
+	{
+		for (;;)
+		{
+			// Walk the retained blocks first, a rewound arena reuses them in order
+			for (; current < blocks.size(); ++current, offset = 0)
+			{
+				Block& block = blocks[current];
+				void* p = block.data.get() + offset;
+				size_t space = block.size - offset;
+
+				if (std::align(alignment, bytes, p, space))
+				{
+					offset = block.size - space + bytes;
+					return p;
+				}
+			}
+
+			const size_t size = std::max(block_size, bytes + alignment);
+			blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+			current = blocks.size() - 1;
+			offset = 0;
+		}
+	}
+
+	void ScratchArena::do_deallocate(void*, size_t, size_t)
+	{
+		// Monotonic: memory comes back on rewind()/reset()
+	}
+
+	bool ScratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+
+	ArenaScope::ArenaScope(ScratchArena& arena) : arena(arena), marker(arena.mark())
+	{
+	}
+
+	ArenaScope::~ArenaScope()
+	{
+		arena.rewind(marker);
+	}
+}
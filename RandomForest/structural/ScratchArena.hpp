@@ -0,0 +1,79 @@
+#ifndef __ML_RF_STRUCTURAL_SCRATCH_ARENA__
+#define __ML_RF_STRUCTURAL_SCRATCH_ARENA__
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <memory_resource>
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Per-thread bump allocator for training scratch memory.
+	 *
+	 * Blocks are kept when the arena is rewound, so once a thread has
+	 * built its first tree the builder stops hitting the global allocator.
+	 */
+	class ScratchArena final : public std::pmr::memory_resource
+	{
+	public:
+		struct Marker
+		{
+			size_t block;
+			size_t offset;
+		};
+
+		static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+		ScratchArena(size_t block_size = BLOCK_SIZE);
+		ScratchArena(const ScratchArena&) = delete;
+		ScratchArena& operator=(const ScratchArena&) = delete;
+
+		static ScratchArena& local();
+
+		Marker mark() const;
+		void rewind(const Marker& marker);
+		void reset();
+		size_t capacity() const;
+
+		~ScratchArena() = default;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		struct Block
+		{
+			std::unique_ptr<std::byte[]> data;
+			size_t size;
+		};
+
+		std::vector<Block> blocks;
+		size_t block_size;
+		size_t current = 0;
+		size_t offset = 0;
+	};
+
+	/**
+	 * Rewinds the arena to where it was on construction.
+	 * Everything allocated inside the scope must be dead by then.
+	 */
+	class ArenaScope
+	{
+	public:
+		ArenaScope(ScratchArena& arena = ScratchArena::local());
+		ArenaScope(const ArenaScope&) = delete;
+		ArenaScope& operator=(const ArenaScope&) = delete;
+		~ArenaScope();
+
+	private:
+		ScratchArena& arena;
+		ScratchArena::Marker marker;
+	};
+
+	template <class T>
+	using scratch_vector = std::pmr::vector<T>;
+}
+
+#endif
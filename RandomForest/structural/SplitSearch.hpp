@@ -0,0 +1,656 @@
+#ifndef __ML_RF_STRUCTURAL_SPLIT_SEARCH__
+#define __ML_RF_STRUCTURAL_SPLIT_SEARCH__
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include "ScratchArena.hpp"
+#include "TaskScheduler.hpp"
+#include "../algorithm/metrics.hpp"
+#include "../algorithm/streams.hpp"
+
+namespace metrics = epsilon::ml::rf::algorithm::metrics;
+namespace streams = epsilon::ml::rf::algorithm::streams;
+
+namespace epsilon::ml::rf::structural
+{
+	struct Split
+	{
+		float gain = 0.0f;
+		int feature = -1;
+		int bin = 0;
+		float threshold = 0.0f;
+		uint64_t categories = 0;  // left codes of a categorical split, 0 otherwise
+	};
+
+	/**
+	 * Read-only view of a binned training set, shared by every node of a tree.
+	 * X_binned is feature-major (features_size x samples_size).
+	 */
+	struct SplitContext
+	{
+		const uint8_t* X_binned;
+		const float* bin_edges;
+		const int* y;
+		size_t samples_size;
+		size_t features_size;
+		size_t n_classes;
+
+		// Exact mode only: raw values and per-feature orders, both feature-major
+		const float* X = nullptr;
+		const int* presorted = nullptr;
+
+		// Candidates leaving fewer samples on either side are not scored
+		size_t min_samples_leaf = 1;
+
+		// Weighted rows (compacted duplicates): count of each class per row,
+		// samples_size x n_classes. y is not read when set.
+		const int* class_counts = nullptr;
+
+		// Per feature, 1 for category codes split by subsets
+		const uint8_t* categorical = nullptr;
+
+		// Per feature, 1 when every bin holds one value, its lower edge
+		const uint8_t* exact_bins = nullptr;
+
+		bool is_categorical(int f) const { return categorical && categorical[f]; }
+		const uint8_t* feature(int f) const { return X_binned + f * samples_size; }
+		const float* edges(int f) const { return bin_edges + f * (metrics::MAX_BINS + 1); }
+		const float* values(int f) const { return X + f * samples_size; }
+		int* order(int* orders, int f) const { return orders + f * samples_size; }
+		size_t histogram_size() const { return metrics::MAX_BINS * n_classes; }
+
+		template <class Counts>
+		void add_row(Counts& counts, int idx, int sign = 1) const
+		{
+			if (!class_counts)
+			{
+				counts.add(y[idx], sign);
+				return;
+			}
+
+			const int* row = class_counts + idx * n_classes;
+			for (size_t k = 0; k < n_classes; k++)
+			{
+				if (row[k]) counts.add(static_cast<int>(k), sign * row[k]);
+			}
+		}
+
+		/**
+		 * add_row over samples[0, n). Weighted rows are summed first, one
+		 * update per class instead of one per row and class.
+		 */
+		template <class Counts>
+		void add_rows(Counts& counts, const int* samples, size_t n, int sign = 1) const
+		{
+			if (!class_counts)
+			{
+				for (size_t i = 0; i < n; i++)
+				{
+					counts.add(y[samples[i]], sign);
+				}
+				return;
+			}
+
+			ArenaScope scope;
+			scratch_vector<int> totals(n_classes, 0, &ScratchArena::local());
+			for (size_t i = 0; i < n; i++)
+			{
+				const int* row = class_counts + samples[i] * n_classes;
+				for (size_t k = 0; k < n_classes; k++)
+				{
+					totals[k] += row[k];
+				}
+			}
+
+			for (size_t k = 0; k < n_classes; k++)
+			{
+				if (totals[k]) counts.add(static_cast<int>(k), sign * totals[k]);
+			}
+		}
+	};
+
+	/**
+	 * hist[(f * MAX_BINS + bin) * n_classes + label] += 1 for samples[begin, end),
+	 * or the row's class counts for weighted rows
+	 */
+	inline void accumulate_histogram(
+		const SplitContext& ctx,
+		const int* features,
+		const size_t n_features,
+		const int* samples,
+		const size_t begin,
+		const size_t end,
+		int* hist)
+	{
+		for (size_t f = 0; f < n_features; f++)
+		{
+			const uint8_t* Xf_binned = ctx.feature(features[f]);
+			int* hist_f = hist + f * ctx.histogram_size();
+
+			if (ctx.class_counts)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const int idx = samples[i];
+					const int* row = ctx.class_counts + idx * ctx.n_classes;
+					int* hist_b = hist_f + Xf_binned[idx] * ctx.n_classes;
+
+					for (size_t k = 0; k < ctx.n_classes; k++)
+					{
+						hist_b[k] += row[k];
+					}
+				}
+
+				continue;
+			}
+
+			for (size_t i = begin; i < end; i++)
+			{
+				if (i + metrics::PREFETCH_DISTANCE < end)
+					__builtin_prefetch(&Xf_binned[samples[i + metrics::PREFETCH_DISTANCE]], 0, 1);
+
+				const int idx = samples[i];
+				++hist_f[Xf_binned[idx] * ctx.n_classes + ctx.y[idx]];
+			}
+		}
+	}
+
+	/**
+	 * Histograms of the selected features over a node.
+	 *
+	 * Nodes of at least parallel_threshold samples are split across the
+	 * scheduler by sample range, each chunk filling its own sub-histogram
+	 * that is summed at the end. Smaller nodes stay on the calling thread.
+	 */
+	inline void build_histogram(
+		const SplitContext& ctx,
+		const int* features,
+		const size_t n_features,
+		const int* samples,
+		const size_t n_samples,
+		int* hist,
+		const size_t parallel_threshold)
+	{
+		const size_t hist_size = n_features * ctx.histogram_size();
+		std::fill(hist, hist + hist_size, 0);
+
+		TaskScheduler& scheduler = TaskScheduler::instance();
+		const size_t n_chunks = scheduler.size();
+
+		if (n_samples < parallel_threshold || n_chunks < 2)
+		{
+			accumulate_histogram(ctx, features, n_features, samples, 0, n_samples, hist);
+			return;
+		}
+
+		ArenaScope scope;
+		scratch_vector<int> sub_hists(n_chunks * hist_size, 0, &ScratchArena::local());
+
+		scheduler.parallel_for(0, n_chunks, 1, [&] (const size_t begin, const size_t end) {
+			for (size_t c = begin; c < end; c++)
+			{
+				accumulate_histogram(ctx, features, n_features, samples,
+					n_samples * c / n_chunks, n_samples * (c + 1) / n_chunks,
+					sub_hists.data() + c * hist_size);
+			}
+		});
+
+		for (size_t c = 0; c < n_chunks; c++)
+		{
+			const int* sub_hist = sub_hists.data() + c * hist_size;
+			for (size_t k = 0; k < hist_size; k++)
+			{
+				hist[k] += sub_hist[k];
+			}
+		}
+	}
+
+	/**
+	 * Best threshold of one feature from its histogram.
+	 * Candidates sit on the lower edge of each non-empty bin, as the
+	 * sample sweep did: left = { bin < split.bin }.
+	 */
+	template <metrics::ImpurityCriterion Criterion>
+	Split sweep_histogram(
+		const SplitContext& ctx,
+		const int feature,
+		const int* hist_f,
+		const metrics::ClassCounts<Criterion>& parent,
+		ScratchArena& arena)
+	{
+		ArenaScope scope(arena);
+		Split best;
+
+		const float* edges = ctx.edges(feature);
+		const size_t n_samples = parent.size();
+		const float parent_impurity = parent.impurity();
+
+		metrics::ClassCounts<Criterion> l_counts(ctx.n_classes, &arena), r_counts(ctx.n_classes, &arena);
+		r_counts.assign(parent);
+
+		for (size_t bin = 0; bin < metrics::MAX_BINS; bin++)
+		{
+			const int* hist_b = hist_f + bin * ctx.n_classes;
+			int n_bin = 0;
+			for (size_t k = 0; k < ctx.n_classes; k++)
+			{
+				n_bin += hist_b[k];
+			}
+
+			if (n_bin == 0) continue;
+
+			const size_t n_left = l_counts.size();
+			const size_t n_right = n_samples - n_left;
+			if (n_left > 0 && n_left >= ctx.min_samples_leaf && n_right >= ctx.min_samples_leaf)
+			{
+
+				float gain = parent_impurity
+					- (static_cast<float>(n_left) / n_samples)  * l_counts.impurity()
+					- (static_cast<float>(n_right) / n_samples) * r_counts.impurity();
+
+				if (gain > best.gain)
+				{
+					best.gain = gain;
+					best.feature = feature;
+					best.bin = static_cast<int>(bin);
+					best.threshold = edges[bin];
+				}
+			}
+
+			for (size_t k = 0; k < ctx.n_classes; k++)
+			{
+				if (hist_b[k] == 0) continue;
+
+				l_counts.add(static_cast<int>(k), hist_b[k]);
+				r_counts.remove(static_cast<int>(k), hist_b[k]);
+			}
+		}
+
+		return best;
+	}
+
+	/**
+	 * Best exact threshold of one feature, order holds the node's samples
+	 * sorted by value. Thresholds sit between consecutive distinct values.
+	 */
+	template <metrics::ImpurityCriterion Criterion>
+	Split sweep_sorted(
+		const SplitContext& ctx,
+		const int feature,
+		const int* order,
+		const size_t n_samples,
+		const metrics::ClassCounts<Criterion>& parent,
+		ScratchArena& arena)
+	{
+		ArenaScope scope(arena);
+		Split best;
+
+		const float* Xf = ctx.values(feature);
+		const float parent_impurity = parent.impurity();
+
+		metrics::ClassCounts<Criterion> l_counts(ctx.n_classes, &arena), r_counts(ctx.n_classes, &arena);
+		r_counts.assign(parent);
+
+		for (size_t i = 0; i + 1 < n_samples; ++i)
+		{
+			const int idx0 = order[i];
+			const float val0 = Xf[idx0];
+			const float val1 = Xf[order[i + 1]];
+			const int moved_label = ctx.y[idx0];
+
+			l_counts.add(moved_label);
+			r_counts.remove(moved_label);
+
+			if (val0 == val1) continue;
+
+			const size_t n_left = i + 1;
+			const size_t n_right = n_samples - n_left;
+			if (n_left < ctx.min_samples_leaf || n_right < ctx.min_samples_leaf) continue;
+
+			float gain = parent_impurity
+				- (static_cast<float>(n_left) / n_samples)  * l_counts.impurity()
+				- (static_cast<float>(n_right) / n_samples) * r_counts.impurity();
+
+			if (gain > best.gain)
+			{
+				// The midpoint can round onto val0 for adjacent floats
+				const float threshold = (val0 + val1) * 0.5f;
+
+				best.gain = gain;
+				best.feature = feature;
+				best.threshold = threshold > val0 ? threshold : val1;
+			}
+		}
+
+		return best;
+	}
+
+	/**
+	 * Class counts per code of a categorical feature, MAX_CATEGORIES x n_classes,
+	 * from its bin histogram. Only features with exact bins are categorical
+	 * (DecisionTree::categorical_mask), the lower edge of a bin is its code.
+	 */
+	inline void categories_from_bins(
+		const SplitContext& ctx,
+		const int feature,
+		const int* hist_f,
+		int* code_hist)
+	{
+		const float* edges = ctx.edges(feature);
+		std::fill(code_hist, code_hist + metrics::MAX_CATEGORIES * ctx.n_classes, 0);
+
+		for (size_t bin = 0; bin < metrics::MAX_BINS; bin++)
+		{
+			const int* hist_b = hist_f + bin * ctx.n_classes;
+			if (std::all_of(hist_b, hist_b + ctx.n_classes, [] (const int c) { return c == 0; })) continue;
+
+			int* code_b = code_hist + static_cast<size_t>(edges[bin]) * ctx.n_classes;
+			for (size_t k = 0; k < ctx.n_classes; k++)
+			{
+				code_b[k] += hist_b[k];
+			}
+		}
+	}
+
+	/**
+	 * Same counts read from a node's rows, raw values in exact mode.
+	 */
+	inline void categories_from_rows(
+		const SplitContext& ctx,
+		const int feature,
+		const int* samples,
+		const size_t n_rows,
+		int* code_hist)
+	{
+		std::fill(code_hist, code_hist + metrics::MAX_CATEGORIES * ctx.n_classes, 0);
+
+		for (size_t i = 0; i < n_rows; i++)
+		{
+			const int idx = samples[i];
+			const float code = ctx.presorted
+				? ctx.values(feature)[idx]
+				: ctx.edges(feature)[ctx.feature(feature)[idx]];
+
+			int* code_b = code_hist + static_cast<size_t>(code) * ctx.n_classes;
+			if (!ctx.class_counts)
+			{
+				++code_b[ctx.y[idx]];
+				continue;
+			}
+
+			const int* row = ctx.class_counts + idx * ctx.n_classes;
+			for (size_t k = 0; k < ctx.n_classes; k++)
+			{
+				code_b[k] += row[k];
+			}
+		}
+	}
+
+	/**
+	 * Best subset of the codes present in a node to send left.
+	 *
+	 * For each class k, codes are sorted by their share of class k and every
+	 * prefix is scored: n_classes sorts instead of 2^codes subsets. With two
+	 * classes one order is enough and the best prefix is the best subset.
+	 */
+	template <metrics::ImpurityCriterion Criterion>
+	Split sweep_categories(
+		const SplitContext& ctx,
+		const int feature,
+		const int* code_hist,
+		const metrics::ClassCounts<Criterion>& parent,
+		ScratchArena& arena)
+	{
+		ArenaScope scope(arena);
+		Split best;
+
+		const size_t n_classes = ctx.n_classes;
+		const size_t n_samples = parent.size();
+		const float parent_impurity = parent.impurity();
+
+		scratch_vector<int> codes(&arena);
+		scratch_vector<int64_t> totals(metrics::MAX_CATEGORIES, 0, &arena);
+		for (size_t code = 0; code < metrics::MAX_CATEGORIES; code++)
+		{
+			const int* hist_c = code_hist + code * n_classes;
+			for (size_t k = 0; k < n_classes; k++)
+			{
+				totals[code] += hist_c[k];
+			}
+
+			if (totals[code] > 0) codes.emplace_back(static_cast<int>(code));
+		}
+
+		if (codes.size() < 2) return best;
+
+		metrics::ClassCounts<Criterion> l_counts(n_classes, &arena), r_counts(n_classes, &arena);
+
+		for (size_t k = 0; k < n_classes; k++)
+		{
+			// share(a) < share(b), cross-multiplied, ties by code
+			std::sort(codes.begin(), codes.end(), [&] (const int a, const int b) {
+				const int64_t lhs = code_hist[a * n_classes + k] * totals[b];
+				const int64_t rhs = code_hist[b * n_classes + k] * totals[a];
+				return lhs < rhs || (lhs == rhs && a < b);
+			});
+
+			l_counts.clear();
+			r_counts.assign(parent);
+			uint64_t left = 0;
+
+			for (size_t c = 0; c + 1 < codes.size(); c++)
+			{
+				const int* hist_c = code_hist + codes[c] * n_classes;
+				for (size_t j = 0; j < n_classes; j++)
+				{
+					if (hist_c[j] == 0) continue;
+
+					l_counts.add(static_cast<int>(j), hist_c[j]);
+					r_counts.remove(static_cast<int>(j), hist_c[j]);
+				}
+				left |= uint64_t(1) << codes[c];
+
+				const size_t n_left = l_counts.size();
+				const size_t n_right = n_samples - n_left;
+				if (n_left < ctx.min_samples_leaf || n_right < ctx.min_samples_leaf) continue;
+
+				float gain = parent_impurity
+					- (static_cast<float>(n_left) / n_samples)  * l_counts.impurity()
+					- (static_cast<float>(n_right) / n_samples) * r_counts.impurity();
+
+				if (gain > best.gain)
+				{
+					best.gain = gain;
+					best.feature = feature;
+					best.categories = left;
+				}
+			}
+
+			if (n_classes == 2) break;
+		}
+
+		return best;
+	}
+
+	/**
+	 * Best split of a node over the given candidate features.
+	 * n_samples counts rows, parent counts their weights.
+	 */
+	template <metrics::ImpurityCriterion Criterion>
+	Split find_split(
+		const SplitContext& ctx,
+		const int* features,
+		const size_t n_features,
+		const int* samples,
+		const size_t n_samples,
+		const metrics::ClassCounts<Criterion>& parent,
+		ScratchArena& arena,
+		const size_t parallel_threshold)
+	{
+		ArenaScope scope(arena);
+		Split best;
+
+		scratch_vector<int> hist(n_features * ctx.histogram_size(), &arena);
+		scratch_vector<int> code_hist(&arena);
+		build_histogram(ctx, features, n_features, samples, n_samples, hist.data(), parallel_threshold);
+
+		for (size_t f = 0; f < n_features; f++)
+		{
+			const int* hist_f = hist.data() + f * ctx.histogram_size();
+			Split candidate;
+
+			if (ctx.is_categorical(features[f]))
+			{
+				code_hist.resize(metrics::MAX_CATEGORIES * ctx.n_classes);
+				categories_from_bins(ctx, features[f], hist_f, code_hist.data());
+				candidate = sweep_categories<Criterion>(ctx, features[f], code_hist.data(), parent, arena);
+			}
+			else
+			{
+				candidate = sweep_histogram<Criterion>(ctx, features[f], hist_f, parent, arena);
+			}
+
+			if (candidate.gain > best.gain)
+			{
+				best = candidate;
+			}
+		}
+
+		return best;
+	}
+
+	/**
+	 * Extremely randomized split: per feature one bin drawn uniformly in
+	 * (min, max] of the node's bins, scored alone. Two passes over the
+	 * samples per feature and no histogram.
+	 */
+	template <metrics::ImpurityCriterion Criterion>
+	Split random_split(
+		const SplitContext& ctx,
+		const int* features,
+		const size_t n_features,
+		const int* samples,
+		const size_t n_rows,
+		const metrics::ClassCounts<Criterion>& parent,
+		streams::Stream& rng,
+		ScratchArena& arena)
+	{
+		ArenaScope scope(arena);
+		Split best;
+
+		const size_t n_samples = parent.size();
+		const float parent_impurity = parent.impurity();
+
+		metrics::ClassCounts<Criterion> l_counts(ctx.n_classes, &arena), r_counts(ctx.n_classes, &arena);
+		scratch_vector<int> code_hist(&arena);
+
+		for (size_t f = 0; f < n_features; f++)
+		{
+			const uint8_t* Xf = ctx.feature(features[f]);
+
+			// Categorical: a random subset of the node's codes goes left
+			if (ctx.is_categorical(features[f]))
+			{
+				const uint64_t bits = rng();
+
+				code_hist.resize(metrics::MAX_CATEGORIES * ctx.n_classes);
+				categories_from_rows(ctx, features[f], samples, n_rows, code_hist.data());
+
+				uint64_t present = 0;
+				for (size_t code = 0; code < metrics::MAX_CATEGORIES; code++)
+				{
+					const int* hist_c = code_hist.data() + code * ctx.n_classes;
+					if (std::any_of(hist_c, hist_c + ctx.n_classes, [] (const int c) { return c > 0; }))
+						present |= uint64_t(1) << code;
+				}
+
+				if (std::popcount(present) < 2) continue;
+
+				uint64_t left = bits & present;
+				if (left == 0 || left == present) left = present & (~present + 1);
+
+				l_counts.clear();
+				r_counts.assign(parent);
+				for (size_t code = 0; code < metrics::MAX_CATEGORIES; code++)
+				{
+					if (!((left >> code) & 1)) continue;
+
+					const int* hist_c = code_hist.data() + code * ctx.n_classes;
+					for (size_t k = 0; k < ctx.n_classes; k++)
+					{
+						if (hist_c[k] == 0) continue;
+
+						l_counts.add(static_cast<int>(k), hist_c[k]);
+						r_counts.remove(static_cast<int>(k), hist_c[k]);
+					}
+				}
+
+				const size_t n_left = l_counts.size();
+				const size_t n_right = n_samples - n_left;
+				if (n_left < ctx.min_samples_leaf || n_right < ctx.min_samples_leaf) continue;
+
+				float gain = parent_impurity
+					- (static_cast<float>(n_left) / n_samples)  * l_counts.impurity()
+					- (static_cast<float>(n_right) / n_samples) * r_counts.impurity();
+
+				if (gain > best.gain)
+				{
+					best = Split();
+					best.gain = gain;
+					best.feature = features[f];
+					best.categories = left;
+				}
+
+				continue;
+			}
+
+			uint8_t lo = 255, hi = 0;
+			for (size_t i = 0; i < n_rows; i++)
+			{
+				lo = std::min(lo, Xf[samples[i]]);
+				hi = std::max(hi, Xf[samples[i]]);
+			}
+
+			// Drawn even for constant features, the stream stays aligned
+			const uint64_t bits = rng();
+			if (lo >= hi) continue;
+
+			const int bin = lo + 1 + static_cast<int>(streams::bounded(bits, hi - lo));
+
+			l_counts.clear();
+			r_counts.assign(parent);
+
+			for (size_t i = 0; i < n_rows; i++)
+			{
+				if (Xf[samples[i]] < bin)
+				{
+					ctx.add_row(l_counts, samples[i]);
+					ctx.add_row(r_counts, samples[i], -1);
+				}
+			}
+
+			const size_t n_left = l_counts.size();
+			const size_t n_right = n_samples - n_left;
+			if (n_left < ctx.min_samples_leaf || n_right < ctx.min_samples_leaf) continue;
+
+			float gain = parent_impurity
+				- (static_cast<float>(n_left) / n_samples)  * l_counts.impurity()
+				- (static_cast<float>(n_right) / n_samples) * r_counts.impurity();
+
+			if (gain > best.gain)
+			{
+				best.gain = gain;
+				best.feature = features[f];
+				best.bin = bin;
+				best.threshold = ctx.edges(features[f])[bin];
+				best.categories = 0;
+			}
+		}
+
+		return best;
+	}
+}
+
+#endif
@@ -8,6 +8,8 @@ namespace epsilon::ml::rf::structural
 	struct StackFrame
 	{
 		std::vector<int> samples;
+		// samples ordered by each feature, features x samples
+		std::vector<int> sorted;
 		std::vector<float> X;
 		std::vector<float> y;
 		int depth;
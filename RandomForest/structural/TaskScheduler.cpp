@@ -0,0 +1,285 @@
+#include "TaskScheduler.hpp"
+#include <chrono>
+
+#ifdef __USE_OMP__
+	#include <omp.h>
+#endif
+
+#ifdef __linux__
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+namespace epsilon::ml::rf::structural
+{
+	namespace
+	{
+		// Scheduler and slot of the calling thread, if it is a worker
+		thread_local const TaskScheduler* current_scheduler = nullptr;
+		thread_local int current_index = -1;
+
+		// Owned under instance_lock, published through instance_ptr
+		std::mutex instance_lock;
+		std::atomic<TaskScheduler*> instance_ptr = nullptr;
+
+		std::unique_ptr<TaskScheduler>& instance_holder()
+		{
+			static std::unique_ptr<TaskScheduler> holder;
+			return holder;
+		}
+
+		// Marks a group's task done however it exits
+		struct PendingGuard
+		{
+			std::atomic<size_t>& pending;
+			~PendingGuard() { pending.fetch_sub(1, std::memory_order_release); }
+		};
+
+	#ifdef __USE_OMP__
+		// One OpenMP thread while a task runs outside the pool's workers
+		struct SerialOmp
+		{
+			const int saved = omp_get_max_threads();
+			SerialOmp() { omp_set_num_threads(1); }
+			~SerialOmp() { omp_set_num_threads(saved); }
+		};
+	#endif
+	}
+
+	TaskScheduler::TaskGroup::TaskGroup(TaskScheduler& scheduler) : scheduler(scheduler)
+	{
+	}
+
+	TaskScheduler::TaskGroup::~TaskGroup()
+	{
+		// An uncollected exception is dropped, destructors do not throw
+		drain();
+	}
+
+	void TaskScheduler::TaskGroup::run(Task task)
+	{
+		pending.fetch_add(1, std::memory_order_relaxed);
+		scheduler.submit([this, task = std::move(task)] {
+			PendingGuard done{ pending };
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(error_lock);
+				if (!error) error = std::current_exception();
+			}
+		});
+	}
+
+	void TaskScheduler::TaskGroup::wait()
+	{
+		drain();
+
+		std::exception_ptr thrown;
+		{
+			std::lock_guard<std::mutex> guard(error_lock);
+			std::swap(thrown, error);
+		}
+
+		if (thrown) std::rethrow_exception(thrown);
+	}
+
+	void TaskScheduler::TaskGroup::drain()
+	{
+		while (pending.load(std::memory_order_acquire) > 0)
+		{
+			if (!scheduler.run_one())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	TaskScheduler::TaskScheduler() : TaskScheduler(Options{})
+	{
+	}
+
+	TaskScheduler::TaskScheduler(const Options& options)
+	{
+		const size_t n_threads = options.n_threads > 0
+			? options.n_threads
+			: std::max<unsigned>(1, std::thread::hardware_concurrency());
+
+		workers.reserve(n_threads);
+		for (size_t i = 0; i < n_threads; i++)
+		{
+			workers.emplace_back(std::make_unique<Worker>());
+		}
+
+		for (size_t i = 0; i < n_threads; i++)
+		{
+			workers[i]->thread = std::thread(&TaskScheduler::loop, this, i, options.pin_threads);
+		}
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> guard(wake_lock);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker->thread.join();
+		}
+	}
+
+	void TaskScheduler::configure(const Options& options)
+	{
+		std::lock_guard<std::mutex> guard(instance_lock);
+		auto& holder = instance_holder();
+		auto replaced = std::make_unique<TaskScheduler>(options);
+		instance_ptr.store(replaced.get(), std::memory_order_release);
+		holder.swap(replaced);
+	}
+
+	TaskScheduler& TaskScheduler::instance()
+	{
+		// Lock-free once published, it is reached for every node
+		if (TaskScheduler* scheduler = instance_ptr.load(std::memory_order_acquire))
+		{
+			return *scheduler;
+		}
+
+		std::lock_guard<std::mutex> guard(instance_lock);
+		auto& holder = instance_holder();
+		if (!holder)
+		{
+			holder = std::make_unique<TaskScheduler>();
+			instance_ptr.store(holder.get(), std::memory_order_release);
+		}
+
+		return *holder;
+	}
+
+	size_t TaskScheduler::size() const
+	{
+		return workers.size();
+	}
+
+	int TaskScheduler::worker_index() const
+	{
+		return current_scheduler == this ? current_index : -1;
+	}
+
+	void TaskScheduler::submit(Task task)
+	{
+		const int index = worker_index();
+		if (index >= 0)
+		{
+			std::lock_guard<std::mutex> guard(workers[index]->lock);
+			workers[index]->tasks.push_back(std::move(task));
+		}
+		else
+		{
+			std::lock_guard<std::mutex> guard(injected_lock);
+			injected.push_back(std::move(task));
+		}
+
+		queued.fetch_add(1, std::memory_order_release);
+		wake.notify_one();
+	}
+
+	bool TaskScheduler::pop(size_t index, Task& task)
+	{
+		Worker& worker = *workers[index];
+		std::lock_guard<std::mutex> guard(worker.lock);
+		if (worker.tasks.empty()) return false;
+
+		task = std::move(worker.tasks.back());
+		worker.tasks.pop_back();
+		return true;
+	}
+
+	bool TaskScheduler::steal(size_t thief, Task& task)
+	{
+		const size_t n = workers.size();
+		for (size_t k = 1; k <= n; k++)
+		{
+			Worker& victim = *workers[(thief + k) % n];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (victim.tasks.empty()) continue;
+
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+
+		std::lock_guard<std::mutex> guard(injected_lock);
+		if (injected.empty()) return false;
+
+		task = std::move(injected.front());
+		injected.pop_front();
+		return true;
+	}
+
+	bool TaskScheduler::run_one()
+	{
+		if (queued.load(std::memory_order_acquire) == 0) return false;
+
+		const int index = worker_index();
+		Task task;
+
+		if (!(index >= 0 && pop(index, task)) && !steal(index >= 0 ? index : 0, task))
+		{
+			return false;
+		}
+
+		queued.fetch_sub(1, std::memory_order_relaxed);
+
+	#ifdef __USE_OMP__
+		if (index < 0)
+		{
+			// A caller helping in wait(), its OpenMP team would add to the workers'
+			SerialOmp serial;
+			task();
+			return true;
+		}
+	#endif
+
+		task();
+		return true;
+	}
+
+	void TaskScheduler::loop(size_t index, bool pin)
+	{
+		current_scheduler = this;
+		current_index = static_cast<int>(index);
+
+	#ifdef __USE_OMP__
+		// The pool owns the cores, OpenMP regions inside tasks stay serial
+		omp_set_num_threads(1);
+	#endif
+
+	#ifdef __linux__
+		if (pin)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(index % std::max<unsigned>(1, std::thread::hardware_concurrency()), &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		}
+	#else
+		(void) pin;
+	#endif
+
+		while (!stopping.load(std::memory_order_acquire))
+		{
+			if (run_one()) continue;
+
+			std::unique_lock<std::mutex> guard(wake_lock);
+			wake.wait_for(guard, std::chrono::milliseconds(1), [&] {
+				return stopping.load() || queued.load() > 0;
+			});
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef __ML_RF_STRUCTURAL_TASK_SCHEDULER__
+#define __ML_RF_STRUCTURAL_TASK_SCHEDULER__
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Work-stealing pool shared by every level of training parallelism.
+	 *
+	 * Whole trees, large subtrees and large histograms are all tasks on
+	 * the same workers. Each worker pops its own deque from the back and
+	 * steals from the front of the others. Threads waiting on a group
+	 * run pending tasks instead of blocking, so nested waits cannot
+	 * deadlock the pool.
+	 *
+	 * Thread count and core pinning are set here and nowhere else
+	 * (configure() before training). OpenMP regions reached from a task,
+	 * on a worker or on a thread helping inside wait(), run single-threaded
+	 * so they never oversubscribe the machine.
+	 */
+	class TaskScheduler
+	{
+	public:
+		using Task = std::function<void()>;
+
+		struct Options
+		{
+			size_t n_threads = 0; // 0 -> std::thread::hardware_concurrency()
+			bool pin_threads = false;
+		};
+
+		class TaskGroup
+		{
+		public:
+			TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance());
+			TaskGroup(const TaskGroup&) = delete;
+			TaskGroup& operator=(const TaskGroup&) = delete;
+			~TaskGroup();
+
+			void run(Task task);
+
+			/**
+			 * Returns once every task ran, rethrowing the first exception
+			 * one of them threw.
+			 */
+			void wait();
+
+		private:
+			void drain();
+
+			TaskScheduler& scheduler;
+			std::atomic<size_t> pending = 0;
+			std::exception_ptr error;
+			std::mutex error_lock;
+		};
+
+		TaskScheduler();
+		TaskScheduler(const Options& options);
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+		~TaskScheduler();
+
+		static void configure(const Options& options);
+		static TaskScheduler& instance();
+
+		size_t size() const;
+		void submit(Task task);
+		bool run_one();
+
+		/**
+		 * fn(begin, end) over [begin, end) in chunks of at least grain.
+		 * The calling thread takes part and returns once every chunk ran.
+		 */
+		template <class F>
+		void parallel_for(size_t begin, size_t end, size_t grain, F&& fn)
+		{
+			if (begin >= end) return;
+
+			const size_t n = end - begin;
+			const size_t n_chunks = std::max<size_t>(1, std::min(size(), n / std::max<size_t>(grain, 1)));
+
+			if (n_chunks == 1)
+			{
+				fn(begin, end);
+				return;
+			}
+
+			TaskGroup group(*this);
+			for (size_t c = 0; c < n_chunks; c++)
+			{
+				const size_t b = begin + n * c / n_chunks;
+				const size_t e = begin + n * (c + 1) / n_chunks;
+				group.run([&fn, b, e] { fn(b, e); });
+			}
+			group.wait();
+		}
+
+	private:
+		struct Worker
+		{
+			std::deque<Task> tasks;
+			std::mutex lock;
+			std::thread thread;
+		};
+
+		void loop(size_t index, bool pin);
+		bool pop(size_t index, Task& task);
+		bool steal(size_t thief, Task& task);
+		int worker_index() const;
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::deque<Task> injected;
+		std::mutex injected_lock;
+
+		std::mutex wake_lock;
+		std::condition_variable wake;
+		std::atomic<size_t> queued = 0;
+		std::atomic<bool> stopping = false;
+	};
+}
+
+#endif
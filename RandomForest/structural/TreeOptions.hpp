@@ -0,0 +1,80 @@
+#ifndef __ML_RF_STRUCTURAL_TREE_OPTIONS__
+#define __ML_RF_STRUCTURAL_TREE_OPTIONS__
+
+#include <cstddef>
+#include <vector>
+
+namespace epsilon::ml::rf::structural
+{
+	/**
+	 * Training-only knobs, never serialized with the model.
+	 */
+	struct TreeOptions
+	{
+		enum class Criterion { Gini, Entropy };
+
+		/**
+		 * DepthFirst: one node at a time, large subtrees grown as parallel tasks.
+		 * LevelWise : every open node of a depth at once, parallel over nodes.
+		 * BestFirst : the open node with the largest impurity decrease first,
+		 *             stops at max_leaf_nodes.
+		 * Oblivious : FastForest grows ObliviousTree, one split per level
+		 *             shared by every node, histogram splits only.
+		 */
+		enum class Growth { DepthFirst, LevelWise, BestFirst, Oblivious };
+
+		/**
+		 * Histogram: thresholds on the edges of up to MAX_BINS quantile bins.
+		 * Exact    : thresholds between consecutive raw values, from feature
+		 *            orders sorted once and carried down by stable partition.
+		 * Random   : extremely randomized trees, one random bin per feature
+		 *            between the node's min and max, no sweep.
+		 */
+		enum class SplitMode { Histogram, Exact, Random };
+
+		Criterion criterion = Criterion::Gini;
+		Growth growth = Growth::DepthFirst;
+		SplitMode split = SplitMode::Histogram;
+
+		// Nodes with at least this many samples build histograms on all threads
+		size_t histogram_threshold = 1 << 15;
+
+		// Depth-first subtrees with at least this many samples become scheduler tasks
+		size_t subtree_task_threshold = 1 << 13;
+
+		// Fraction of the features drawn per node, 0 for sqrt(features)
+		float max_features = 0.0f;
+
+		// Features holding integer codes in [0, 64), split by code subsets
+		// instead of thresholds. A feature with any other value stays ordered.
+		std::vector<int> categorical_features;
+
+		// Best-first leaf budget, 0 for no limit
+		size_t max_leaf_nodes = 0;
+
+		// Every growth mode: leaf size floor, and a split must lower the
+		// impurity by this much, weighted by its share of the root's samples
+		size_t min_samples_leaf = 1;
+		float min_impurity_decrease = 0.0f;
+
+		// FastForest: vote with each tree on the rows its bootstrap left out
+		bool out_of_bag = false;
+
+		// FastForest, binned builds: a larger set (or weighted rows standing
+		// for 2^31 rows or more) gives each tree this many draws over all of
+		// its rows, by 64-bit id, gathered into a block of the distinct rows
+		// drawn. Bounds what each concurrent tree allocates, at most 2^31 - 1
+		size_t block_rows = size_t(1) << 24;
+
+		// DecisionTree: collapse splits whose leaves answer the same after
+		// growth, predictions unchanged
+		bool simplify = false;
+
+		// FastForest, binned builds: cost-complexity pruning of each tree on
+		// the rows its bootstrap left out (DecisionTree::prune), < 0 disables.
+		// Out-of-bag votes then see pruned trees and read optimistic.
+		float prune_alpha = -1.0f;
+	};
+}
+
+#endif
@@ -2,16 +2,50 @@
 #include "../cereal/archives/binary.hpp"
 #include "DecisionTree.hpp"
 #include "FastForest.hpp"
+#include "ObliviousTree.hpp"
+#include "BoostedTrees.hpp"
+#include "ForestDAG.hpp"
 #include "IDecisionNode.hpp"
 
-CEREAL_REGISTER_TYPE(epsilon::ml::rf::structural::DecisionTree)
+// Versioned trees take a new name, the old one reads unversioned archives
+CEREAL_REGISTER_TYPE_WITH_NAME(
+    epsilon::ml::rf::structural::DecisionTree,
+    "epsilon::ml::rf::structural::DecisionTree.versioned"
+)
 CEREAL_REGISTER_POLYMORPHIC_RELATION(
     epsilon::ml::rf::structural::IDecisionNode,
     epsilon::ml::rf::structural::DecisionTree
 )
 
+CEREAL_REGISTER_TYPE_WITH_NAME(
+    epsilon::ml::rf::structural::LegacyDecisionTree,
+    "epsilon::ml::rf::structural::DecisionTree"
+)
+CEREAL_REGISTER_POLYMORPHIC_RELATION(
+    epsilon::ml::rf::structural::IDecisionNode,
+    epsilon::ml::rf::structural::LegacyDecisionTree
+)
+
+CEREAL_REGISTER_TYPE(epsilon::ml::rf::structural::ObliviousTree)
+CEREAL_REGISTER_POLYMORPHIC_RELATION(
+    epsilon::ml::rf::structural::IDecisionNode,
+    epsilon::ml::rf::structural::ObliviousTree
+)
+
 CEREAL_REGISTER_TYPE(epsilon::ml::rf::structural::FastForest)
 CEREAL_REGISTER_POLYMORPHIC_RELATION(
     epsilon::ml::rf::structural::IDecisionNode,
     epsilon::ml::rf::structural::FastForest
+)
+
+CEREAL_REGISTER_TYPE(epsilon::ml::rf::structural::BoostedTrees)
+CEREAL_REGISTER_POLYMORPHIC_RELATION(
+    epsilon::ml::rf::structural::IDecisionNode,
+    epsilon::ml::rf::structural::BoostedTrees
+)
+
+CEREAL_REGISTER_TYPE(epsilon::ml::rf::structural::ForestDAG)
+CEREAL_REGISTER_POLYMORPHIC_RELATION(
+    epsilon::ml::rf::structural::IDecisionNode,
+    epsilon::ml::rf::structural::ForestDAG
 )
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "RandomForest/structural/DecisionTree.hpp"
 #include "RandomForest/structural/FastForest.hpp"
+#include "RandomForest/structural/BoostedTrees.hpp"
 #include "RandomForest/cereal/archives/binary.hpp"
 #include "RandomForest/web/crow_all.h"
 #include <algorithm>
@@ -7,8 +8,42 @@
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <string>
+#include <stdexcept>
 
 using epsilon::ml::rf::structural::FastForest;
+using epsilon::ml::rf::structural::IDecisionNode;
+
+// Any model saved as std::unique_ptr<IDecisionNode> (forest, boosted trees),
+// or a forest saved as std::unique_ptr<FastForest>, older ones included.
+// A wrong format reads garbage lengths, so any exception means "not this one".
+std::unique_ptr<IDecisionNode> load_model(const std::string& path)
+{
+    try
+    {
+        std::unique_ptr<IDecisionNode> model;
+        std::ifstream is(path, std::ios::binary);
+        cereal::BinaryInputArchive archive(is);
+        archive(model);
+        return model;
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    try
+    {
+        std::unique_ptr<FastForest> forest;
+        std::ifstream is(path, std::ios::binary);
+        cereal::BinaryInputArchive archive(is);
+        archive(forest);
+        return forest;
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(path + ": not a model archive this server can read (" + e.what() + ")");
+    }
+}
 
 int main()
 {
@@ -27,10 +62,16 @@ int main()
         port = std::stoi(env_p);
     }
 
-    std::unique_ptr<FastForest> forest;
-    std::ifstream is("model.bin", std::ios::binary);
-    cereal::BinaryInputArchive archive(is);
-    archive(forest);
+    std::unique_ptr<IDecisionNode> model;
+    try
+    {
+        model = load_model("model.bin");
+    }
+    catch (const std::exception& e)
+    {
+        CROW_LOG_CRITICAL << e.what();
+        return 1;
+    }
 
     CROW_ROUTE(app, "/rf/prediction/videos")
     .methods("POST"_method) 
@@ -68,7 +109,7 @@ int main()
         for (size_t i = 0; i < n_samples; i++)
         {
             y.emplace_back(
-                forest->predict(X.data() + i * FEATURES_SIZE, FEATURES_SIZE));
+                model->predict(X.data() + i * FEATURES_SIZE, FEATURES_SIZE));
         }
 
         result["prediction"] = y;
@@ -106,7 +147,7 @@ int main()
                 return static_cast<float>(v.d()); 
             });
 
-        int y = forest->predict(X);
+        int y = model->predict(X);
 
         result["prediction"] = y;
         result["message"] = "Ok ;)";
@@ -14,6 +14,7 @@
 
 using epsilon::ml::rf::structural::DecisionTree;
 using epsilon::ml::rf::structural::FastForest;
+using epsilon::ml::rf::structural::TreeOptions;
 using epsilon::ml::rf::experimental::BeastForest;
 
 // g++ -fopenmp -O3 -march=native -std=c++23 main.cpp RandomForest/algorithm/*.cpp RandomForest/structural/*.cpp -D__USE_OMP__ -o main
@@ -129,7 +130,12 @@ int main()
     int max_depth = static_cast<int>(std::log2(SAMPLES_SIZE));
     std::pair<int, int> depth = std::make_pair(0, max_depth);
 
+    TreeOptions options;
+    options.out_of_bag = true;
+    options.categorical_features = { 1 };  // resolution code
+
     auto forest = std::make_unique<FastForest>(100);
+    forest->set_options(options);
     forest->build(X, y, std::make_pair(FEATURES_SIZE, SAMPLES_SIZE), depth, rng);
 
     std::vector<float> test1 = { 3.5f, 1.0f, 0.91f, 38.f   };
@@ -143,29 +149,22 @@ int main()
     std::cout << "Test 3: Prédiction = " 
               << forest->predict(test3) << " (attendu: 2)" << std::endl;
 
-    std::atomic<int> correct = 0;
-    #pragma omp parallel
-    {
-        std::vector<float> sample(FEATURES_SIZE);
+    // Each row is scored by the trees that did not train on it
+    const auto& oob = forest->out_of_bag();
+
+    std::cout << "Précision out-of-bag: " 
+              << (100.0 * oob.accuracy) 
+              << "% (" << oob.evaluated << "/" << SAMPLES_SIZE << " lignes)" << std::endl;
 
-        #pragma omp for schedule(dynamic)
-        for (size_t i = 0; i < SAMPLES_SIZE; ++i) 
+    std::cout << "Matrice de confusion (réel x prédit):" << std::endl;
+    for (size_t actual = 0; actual < oob.n_classes; actual++)
+    {
+        for (size_t predicted = 0; predicted < oob.n_classes; predicted++)
         {
-            for (size_t f = 0; f < FEATURES_SIZE; f++)
-            {
-                sample[f] = X[f * SAMPLES_SIZE + i];
-            }
-
-            if (forest->predict(sample) == y[i]) 
-            {
-                correct++;
-            }
+            std::cout << "\t" << oob.confusion[actual * oob.n_classes + predicted];
         }
+        std::cout << std::endl;
     }
-
-    std::cout << "Précision sur training set: " 
-              << (100.0 * correct.load() / SAMPLES_SIZE) 
-              << "%" << std::endl;
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,426 @@
+#include "RandomForest/structural/FastForest.hpp"
+#include "RandomForest/structural/MappedDataset.hpp"
+#include "RandomForest/structural/HyperSearch.hpp"
+#include "RandomForest/structural/BoostedTrees.hpp"
+#include "RandomForest/structural/EnsemblePruner.hpp"
+#include "RandomForest/structural/ForestDAG.hpp"
+#include "RandomForest/structural/TaskScheduler.hpp"
+#include "RandomForest/cereal/archives/binary.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __USE_OMP__
+    #include <omp.h>
+#endif
+
+using epsilon::ml::rf::structural::FastForest;
+using epsilon::ml::rf::structural::MappedDataset;
+using epsilon::ml::rf::structural::BinnedDataset;
+using epsilon::ml::rf::structural::TaskScheduler;
+using epsilon::ml::rf::structural::TreeOptions;
+using epsilon::ml::rf::structural::HyperSearch;
+using epsilon::ml::rf::structural::BoostedTrees;
+using epsilon::ml::rf::structural::EnsemblePruner;
+using epsilon::ml::rf::structural::ForestDAG;
+using epsilon::ml::rf::structural::IDecisionNode;
+
+// Build (one line, the source globs cannot sit in a block comment):
+// g++ -I./RandomForest -fopenmp -O3 -march=native -std=c++20 trainer.cpp RandomForest/algorithm/*.cpp RandomForest/structural/*.cpp -D__USE_OMP__ -o trainer
+
+/*
+Sharded training on a dataset written by MappedDataset::write.
+Tree c of a forest only depends on (seed, c): shards train disjoint tree
+ranges with the same seed, in parallel processes or on several boxes
+sharing a filesystem, and merge into the model a single process gives.
+
+./trainer train data.rfc model.bin <trees> <shards> <max_depth> [seed]
+    forks <shards> local processes, then merges their parts
+
+./trainer shard data.rfc part.bin <trees> <shard> <shards> <max_depth> <seed> [threads]
+    trains trees [shard * trees / shards, (shard + 1) * trees / shards)
+
+./trainer merge model.bin part0.bin part1.bin ...
+    concatenates partial forests, in the given order
+
+./trainer extend model.bin data.rfc <trees> <max_depth> [drop_oldest] [seed]
+    warm start: appends <trees> trees trained on data.rfc to model.bin,
+    after dropping its <drop_oldest> oldest trees
+
+./trainer anytime data.rfc model.bin <seconds> <max_depth> [patience] [seed]
+    as many trees as fit in <seconds> of wall time, stopping early once
+    out-of-bag accuracy has not improved for <patience> batches
+
+./trainer search data.rfc [folds] [seed]
+    trains a grid of forests on one binning, scored out-of-bag (folds = 0)
+    or by k-fold, and marks the accuracy-latency frontier
+
+./trainer simplify model.bin
+    collapses the splits of every tree whose leaves answer the same,
+    predictions are unchanged
+
+./trainer prune model.bin valid.rfc out.bin [agreement] [tolerance]
+    greedy subset of the trees whose vote matches the whole forest on
+    <agreement> of valid.rfc (0.999), or whose accuracy is within
+    <tolerance> of it (off unless given)
+
+./trainer dag model.bin out.bin
+    shares identical subtrees of the forest in one node pool, saved as
+    an IDecisionNode the server loads like a forest
+
+./trainer boost data.rfc model.bin <rounds> <max_depth> [learning_rate]
+    gradient-boosted trees, saved as an IDecisionNode the server loads
+    like a forest
+*/
+
+void save(const std::string& path, std::unique_ptr<FastForest>& forest)
+{
+    std::ofstream os(path, std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+    archive(forest);
+}
+
+std::unique_ptr<FastForest> load(const std::string& path)
+{
+    std::unique_ptr<FastForest> forest;
+    std::ifstream is(path, std::ios::binary);
+    cereal::BinaryInputArchive archive(is);
+    archive(forest);
+    return forest;
+}
+
+int shard(const std::string& data_path, const std::string& out,
+    size_t trees, size_t index, size_t shards, int max_depth, uint64_t seed, size_t threads)
+{
+    if (threads)
+    {
+        TaskScheduler::configure({ threads, false });
+    #ifdef __USE_OMP__
+        omp_set_num_threads(static_cast<int>(threads));
+    #endif
+    }
+
+    if (index >= shards)
+    {
+        std::cerr << "shard " << index << " out of " << shards << std::endl;
+        return 1;
+    }
+
+    const size_t first = index * trees / shards;
+    const size_t last = (index + 1) * trees / shards;
+
+    MappedDataset dataset(data_path);
+    const BinnedDataset data = dataset.bin();
+
+    auto forest = std::make_unique<FastForest>(last - first);
+    forest->build(data, std::make_pair(0, max_depth), seed, first, last);
+    save(out, forest);
+
+    std::cout << "shard " << index << ": trees [" << first << ", " << last << ") -> " << out << std::endl;
+    return 0;
+}
+
+int merge(const std::string& out, const std::vector<std::string>& parts)
+{
+    auto forest = std::make_unique<FastForest>(0);
+    for (const std::string& part : parts)
+    {
+        std::unique_ptr<FastForest> partial = load(part);
+        forest->merge(std::move(*partial));
+    }
+
+    save(out, forest);
+
+    std::cout << forest->count << " trees -> " << out << std::endl;
+    return 0;
+}
+
+int extend(const std::string& model, const std::string& data_path,
+    size_t trees, int max_depth, size_t drop_oldest, uint64_t seed)
+{
+    std::unique_ptr<FastForest> forest = load(model);
+    const size_t before = forest->count;
+
+    MappedDataset dataset(data_path);
+    const BinnedDataset data = dataset.bin();
+
+    std::seed_seq seq = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    std::mt19937 rng(seq);
+    forest->extend(data, std::make_pair(0, max_depth), trees, drop_oldest, rng);
+
+    save(model, forest);
+
+    std::cout << before << " - " << std::min(drop_oldest, before) << " + " << trees
+              << " = " << forest->count << " trees -> " << model << std::endl;
+    return 0;
+}
+
+int anytime(const std::string& data_path, const std::string& out,
+    double seconds, int max_depth, size_t patience, uint64_t seed)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    MappedDataset dataset(data_path);
+    const BinnedDataset data = dataset.bin();
+
+    TreeOptions options;
+    options.out_of_bag = true;
+
+    FastForest::Budget budget;
+    budget.wall_seconds = seconds - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    budget.patience = patience;
+
+    std::seed_seq seq = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    std::mt19937 rng(seq);
+
+    auto forest = std::make_unique<FastForest>(0);
+    forest->set_options(options);
+    forest->build(data, std::make_pair(0, max_depth), budget, rng);
+    save(out, forest);
+
+    std::cout << forest->count << " trees, out-of-bag accuracy "
+              << forest->out_of_bag().accuracy << " -> " << out << std::endl;
+    return 0;
+}
+
+int search(const std::string& data_path, size_t folds, uint64_t seed)
+{
+    MappedDataset dataset(data_path);
+    const BinnedDataset data = dataset.bin();
+
+    HyperSearch hyper(data, {}, folds);
+    const std::vector<HyperSearch::Candidate> candidates = HyperSearch::grid(
+        { 50, 100 }, { 8, 16, 24 }, { 0.0f, 0.5f }, { 1, 5 });
+
+    const std::vector<HyperSearch::Result> results = hyper.run(candidates, seed);
+
+    std::cout << "trees depth features leaf  accuracy  latency(us)     nodes" << std::endl;
+    std::cout << std::fixed;
+    for (const HyperSearch::Result& r : results)
+    {
+        std::cout << std::setw(5) << r.candidate.n_trees
+                  << std::setw(6) << r.candidate.max_depth
+                  << std::setw(9) << std::setprecision(2) << r.candidate.max_features
+                  << std::setw(5) << r.candidate.min_samples_leaf
+                  << std::setw(10) << std::setprecision(4) << r.accuracy
+                  << std::setw(13) << std::setprecision(2) << r.latency_us
+                  << std::setw(10) << r.nodes
+                  << (r.frontier ? "  *" : "") << std::endl;
+    }
+
+    return 0;
+}
+
+int simplify(const std::string& model)
+{
+    std::unique_ptr<FastForest> forest = load(model);
+    const size_t removed = forest->simplify();
+    save(model, forest);
+
+    std::cout << removed << " nodes removed -> " << model << std::endl;
+    return 0;
+}
+
+int prune(const std::string& model, const std::string& valid_path,
+    const std::string& out, double agreement, double tolerance)
+{
+    std::unique_ptr<FastForest> forest = load(model);
+    MappedDataset valid(valid_path);
+
+    const EnsemblePruner pruner(*forest, valid.column(0), valid.samples_size(),
+        valid.labels(), valid.samples_size());
+    const EnsemblePruner::Result result = pruner.run({ agreement, tolerance });
+
+    std::unique_ptr<FastForest> reduced = pruner.reduce(result);
+    save(out, reduced);
+
+    std::cout << std::fixed << std::setprecision(4)
+              << forest->count << " -> " << reduced->count << " trees, agreement "
+              << (result.agreement.empty() ? 0.0 : result.agreement.back())
+              << ", accuracy " << (result.accuracy.empty() ? 0.0 : result.accuracy.back())
+              << " (full " << result.full_accuracy << ") -> " << out << std::endl;
+    return 0;
+}
+
+int dag(const std::string& model, const std::string& out)
+{
+    std::unique_ptr<FastForest> forest = load(model);
+
+    size_t tree_nodes = 0;
+    for (const auto& node : forest->nodes)
+    {
+        tree_nodes += FastForest::visit(*node, [] (const auto& tree) { return static_cast<size_t>(tree.size()); });
+    }
+
+    auto pooled = std::make_unique<ForestDAG>(*forest);
+    const size_t pool_nodes = pooled->node_pool().size();
+
+    std::unique_ptr<IDecisionNode> saved = std::move(pooled);
+    std::ofstream os(out, std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+    archive(saved);
+
+    std::cout << tree_nodes << " tree nodes -> " << pool_nodes << " pooled splits -> " << out << std::endl;
+    return 0;
+}
+
+int boost(const std::string& data_path, const std::string& out,
+    size_t rounds, int max_depth, float learning_rate)
+{
+    MappedDataset dataset(data_path);
+    const BinnedDataset data = dataset.bin();
+
+    BoostedTrees::Params params;
+    params.rounds = rounds;
+    params.learning_rate = learning_rate;
+
+    auto booster = std::make_unique<BoostedTrees>(params);
+    booster->build(data, std::make_pair(0, max_depth));
+
+    // Through the base pointer, cereal then records the concrete type
+    std::unique_ptr<IDecisionNode> model = std::move(booster);
+    std::ofstream os(out, std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+    archive(model);
+
+    std::cout << rounds << " rounds, " << static_cast<BoostedTrees&>(*model).size()
+              << " nodes -> " << out << std::endl;
+    return 0;
+}
+
+int train(const std::string& data_path, const std::string& out,
+    size_t trees, size_t shards, int max_depth, uint64_t seed)
+{
+    if (shards == 0)
+    {
+        std::cerr << "at least one shard" << std::endl;
+        return 1;
+    }
+
+    const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t threads = std::max<size_t>(1, cores / shards);
+
+    std::vector<std::string> parts;
+    std::vector<pid_t> children;
+
+    for (size_t s = 0; s < shards; s++)
+    {
+        parts.emplace_back(out + ".part" + std::to_string(s));
+
+        const pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cerr << "fork failed" << std::endl;
+            return 1;
+        }
+
+        if (pid == 0)
+        {
+            _exit(shard(data_path, parts.back(), trees, s, shards, max_depth, seed, threads));
+        }
+
+        children.emplace_back(pid);
+    }
+
+    int failed = 0;
+    for (const pid_t pid : children)
+    {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+
+    if (failed)
+    {
+        std::cerr << failed << " shard(s) failed" << std::endl;
+        return 1;
+    }
+
+    merge(out, parts);
+
+    for (const std::string& part : parts)
+    {
+        std::remove(part.c_str());
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const std::string command = argc > 1 ? argv[1] : "";
+
+    if (command == "train" && argc >= 7)
+    {
+        const uint64_t seed = argc > 7 ? std::stoull(argv[7]) : std::random_device{}();
+        return train(argv[2], argv[3], std::stoul(argv[4]), std::stoul(argv[5]), std::stoi(argv[6]), seed);
+    }
+
+    if (command == "shard" && argc >= 9)
+    {
+        const size_t threads = argc > 9 ? std::stoul(argv[9]) : 0;
+        return shard(argv[2], argv[3], std::stoul(argv[4]), std::stoul(argv[5]), std::stoul(argv[6]),
+            std::stoi(argv[7]), std::stoull(argv[8]), threads);
+    }
+
+    if (command == "merge" && argc >= 4)
+    {
+        return merge(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (command == "anytime" && argc >= 6)
+    {
+        const size_t patience = argc > 6 ? std::stoul(argv[6]) : 0;
+        const uint64_t seed = argc > 7 ? std::stoull(argv[7]) : std::random_device{}();
+        return anytime(argv[2], argv[3], std::stod(argv[4]), std::stoi(argv[5]), patience, seed);
+    }
+
+    if (command == "extend" && argc >= 6)
+    {
+        const size_t drop_oldest = argc > 6 ? std::stoul(argv[6]) : 0;
+        const uint64_t seed = argc > 7 ? std::stoull(argv[7]) : std::random_device{}();
+        return extend(argv[2], argv[3], std::stoul(argv[4]), std::stoi(argv[5]), drop_oldest, seed);
+    }
+
+    if (command == "search" && argc >= 3)
+    {
+        const size_t folds = argc > 3 ? std::stoul(argv[3]) : 0;
+        const uint64_t seed = argc > 4 ? std::stoull(argv[4]) : std::random_device{}();
+        return search(argv[2], folds, seed);
+    }
+
+    if (command == "simplify" && argc >= 3)
+    {
+        return simplify(argv[2]);
+    }
+
+    if (command == "prune" && argc >= 5)
+    {
+        const double agreement = argc > 5 ? std::stod(argv[5]) : 0.999;
+        const double tolerance = argc > 6 ? std::stod(argv[6]) : -1.0;
+        return prune(argv[2], argv[3], argv[4], agreement, tolerance);
+    }
+
+    if (command == "dag" && argc >= 4)
+    {
+        return dag(argv[2], argv[3]);
+    }
+
+    if (command == "boost" && argc >= 6)
+    {
+        const float learning_rate = argc > 6 ? std::stof(argv[6]) : 0.1f;
+        return boost(argv[2], argv[3], std::stoul(argv[4]), std::stoi(argv[5]), learning_rate);
+    }
+
+    std::cerr << "usage: trainer train|shard|merge|extend|anytime|search|simplify|prune|dag|boost ... (see trainer.cpp)" << std::endl;
+    return 2;
+}